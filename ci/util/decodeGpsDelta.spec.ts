@@ -0,0 +1,27 @@
+import { strict as assert } from 'assert'
+import { readFileSync } from 'fs'
+import * as path from 'path'
+import { decodeGpsDelta, GpsEntry } from './decodeGpsDelta'
+
+/**
+ * Round-trips a batch message that was encoded by the firmware with
+ * CONFIG_GPS_BUFFER_DELTA_ENCODING. The fixture is written by the
+ * gpsd_fixture host test in tests/host, which fails if the firmware encoding
+ * no longer matches it.
+ */
+const fixture = JSON.parse(
+	readFileSync(
+		path.resolve(process.cwd(), 'ci', 'util', 'test-data', 'gpsd.json'),
+		'utf-8',
+	),
+) as {
+	message: { gpsd: Parameters<typeof decodeGpsDelta>[0] }
+	gps: GpsEntry[]
+}
+
+assert.deepEqual(decodeGpsDelta(fixture.message.gpsd), fixture.gps)
+
+// A message with only the base entry
+assert.deepEqual(decodeGpsDelta([fixture.message.gpsd[0]]), [fixture.gps[0]])
+
+console.log('decodeGpsDelta: PASS')
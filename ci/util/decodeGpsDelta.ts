@@ -0,0 +1,68 @@
+export type GpsEntry = {
+	v: {
+		lng: number
+		lat: number
+		acc: number
+		alt: number
+		spd: number
+		hdg: number
+	}
+	ts: number
+}
+
+type GpsDeltaBase = GpsEntry
+type GpsDelta = [
+	ts: number,
+	lng: number,
+	lat: number,
+	acc: number,
+	alt: number,
+	spd: number,
+	hdg: number,
+]
+
+const fixedPointScale = 1000000
+
+/**
+ * Decodes the "gpsd" array of a batch message published with
+ * CONFIG_GPS_BUFFER_DELTA_ENCODING into regular "gps" entries.
+ *
+ * The first element is the base entry with the coordinates in fixed-point
+ * 1e-6 degrees. Every following element is an array
+ * [ts, lng, lat, acc, alt, spd, hdg] where ts, lng and lat are deltas to the
+ * previous entry, and acc, alt, spd and hdg are absolute values.
+ */
+export const decodeGpsDelta = (
+	gpsd: [GpsDeltaBase, ...GpsDelta[]],
+): GpsEntry[] => {
+	if (gpsd.length === 0) return []
+	const [base, ...deltas] = gpsd
+	let ts = base.ts
+	let lng = base.v.lng
+	let lat = base.v.lat
+	const toEntry = ({
+		acc,
+		alt,
+		spd,
+		hdg,
+	}: Pick<GpsEntry['v'], 'acc' | 'alt' | 'spd' | 'hdg'>): GpsEntry => ({
+		v: {
+			lng: lng / fixedPointScale,
+			lat: lat / fixedPointScale,
+			acc,
+			alt,
+			spd,
+			hdg,
+		},
+		ts,
+	})
+	return [
+		toEntry(base.v),
+		...deltas.map(([dts, dlng, dlat, acc, alt, spd, hdg]) => {
+			ts += dts
+			lng += dlng
+			lat += dlat
+			return toEntry({ acc, alt, spd, hdg })
+		}),
+	]
+}
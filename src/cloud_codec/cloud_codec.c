@@ -12,1118 +12,1192 @@
 #include <modem/modem_info.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "cJSON.h"
-#include "cJSON_os.h"
+#include <stddef.h>
+#include "cloud_codec_backend.h"
 #include <net/cloud.h>
 #include <date_time.h>
 #include <math.h>
+#include <sys/crc.h>
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(cloud_codec, CONFIG_CAT_TRACKER_LOG_LEVEL);
 
-#define ACCELEROMETER_TOTAL_AXIS 3
+/* Number of decimals that measured values are published with. */
+#define PREC_COORD CLOUD_DATA_COORD_DECIMALS
+#define PREC_GPS CLOUD_DATA_GPS_DECIMALS
+#define PREC_ENV CLOUD_DATA_ENV_DECIMALS
+#define PREC_ACCEL CLOUD_DATA_ACCEL_DECIMALS
 
-static int json_add_obj(cJSON *parent, const char *str, cJSON *item)
+/* Changes that are not reported to the device shadow, in units of the last
+ * published decimal.
+ */
+#if defined(CONFIG_CLOUD_CODEC_DELTA_REPORTING)
+#define TOL_BAT CONFIG_CLOUD_CODEC_DELTA_BAT_TOLERANCE
+#define TOL_RSRP CONFIG_CLOUD_CODEC_DELTA_RSRP_TOLERANCE
+#define TOL_ENV CONFIG_CLOUD_CODEC_DELTA_ENV_TOLERANCE
+#else
+#define TOL_BAT 0
+#define TOL_RSRP 0
+#define TOL_ENV 0
+#endif
+
+/* Keys of the measured values, shortened if CONFIG_CLOUD_CODEC_SHORT_KEYS
+ * is set. Data type, "v" and "ts" keys are never shortened.
+ */
+#if defined(CONFIG_CLOUD_CODEC_SHORT_KEYS)
+#define KEY(_long, _short) _short
+#else
+#define KEY(_long, _short) _long
+#endif
+
+static void number_add(struct codec_writer *writer, const char *key,
+		       double value, uint8_t decimals)
 {
-	cJSON_AddItemToObject(parent, str, item);
-
-	return 0;
+	if (IS_ENABLED(CONFIG_CLOUD_CODEC_FIELD_PRECISION)) {
+		codec_writer_number_prec(writer, key, value, decimals);
+	} else {
+		codec_writer_number(writer, key, value);
+	}
 }
 
-static int json_add_obj_array(cJSON *parent, cJSON *item)
+/* Add a fixed-point value with the given number of decimals. */
+static void fixed_add(struct codec_writer *writer, const char *key,
+		      int32_t value, uint8_t decimals)
 {
-	cJSON_AddItemToArray(parent, item);
-
-	return 0;
+	if (decimals == 0) {
+		codec_writer_number(writer, key, value);
+	} else {
+		number_add(writer, key, value / pow(10.0, decimals), decimals);
+	}
 }
 
-static int json_add_number(cJSON *parent, const char *str, double item)
+static bool key_matches(const char *key, size_t key_len, const char *str)
 {
-	cJSON *json_num;
-
-	json_num = cJSON_CreateNumber(item);
-	if (json_num == NULL) {
-		return -ENOMEM;
-	}
-
-	return json_add_obj(parent, str, json_num);
+	return (strlen(str) == key_len) && (memcmp(key, str, key_len) == 0);
 }
 
-static int json_add_bool(cJSON *parent, const char *str, int item)
+void codec_cfg_value_set(struct cloud_data_cfg *cfg, const char *key,
+			 size_t key_len, int value)
 {
-	cJSON *json_bool;
-
-	json_bool = cJSON_CreateBool(item);
-	if (json_bool == NULL) {
-		return -ENOMEM;
+	if (key_matches(key, key_len, "gpst")) {
+		if (cfg->gpst != value) {
+			cfg->gpst = value;
+			LOG_DBG("SETTING GPST TO: %d", value);
+		}
+	} else if (key_matches(key, key_len, "act")) {
+		if (cfg->act != value) {
+			cfg->act = value;
+			LOG_DBG("SETTING ACTIVE TO: %d", value);
+		}
+	} else if (key_matches(key, key_len, "actwt")) {
+		if (cfg->actw != value) {
+			cfg->actw = value;
+			LOG_DBG("SETTING ACTIVE WAIT TO: %d", value);
+		}
+	} else if (key_matches(key, key_len, "mvres")) {
+		if (cfg->pasw != value) {
+			cfg->pasw = value;
+			LOG_DBG("SETTING PASSIVE_WAIT TO: %d", value);
+		}
+	} else if (key_matches(key, key_len, "mvt")) {
+		if (cfg->movt != value) {
+			cfg->movt = value;
+			LOG_DBG("SETTING MOVEMENT TIMEOUT TO: %d", value);
+		}
+	} else if (key_matches(key, key_len, "acct")) {
+		if (cfg->acct != value) {
+			cfg->acct = value;
+			LOG_DBG("SETTING ACCEL THRESHOLD TIMEOUT TO: %d",
+				value);
+		}
 	}
-
-	return json_add_obj(parent, str, json_bool);
 }
 
-static cJSON *json_object_decode(cJSON *obj, const char *str)
+static uint32_t stats_start(void)
 {
-	return obj ? cJSON_GetObjectItem(obj, str) : NULL;
+	return IS_ENABLED(CONFIG_CLOUD_CODEC_STATS) ? k_cycle_get_32() : 0;
 }
 
-static int json_add_str(cJSON *parent, const char *str, const char *item)
+/* Log the cost of one codec operation in a machine readable format,
+ * "<STATS:CODEC> op=<operation> entries=<n> bytes=<n> ns=<n>".
+ */
+static void stats_log(const char *op, uint32_t start, size_t entries,
+		      size_t bytes)
 {
-	cJSON *json_str;
+	uint32_t ns;
 
-	json_str = cJSON_CreateString(item);
-	if (json_str == NULL) {
-		return -ENOMEM;
+	if (!IS_ENABLED(CONFIG_CLOUD_CODEC_STATS)) {
+		return;
 	}
 
-	return json_add_obj(parent, str, json_str);
+	ns = (uint32_t)k_cyc_to_ns_floor64(k_cycle_get_32() - start);
+
+	LOG_INF("<STATS:CODEC> op=%s entries=%zu bytes=%zu ns=%u", op, entries,
+		bytes, ns);
 }
 
-int cloud_codec_decode_response(char *input, struct cloud_data_cfg *data)
+int cloud_codec_decode_response(char *input, size_t len,
+				struct cloud_data_cfg *data)
 {
-	char *string = NULL;
-	cJSON *root_obj = NULL;
-	cJSON *group_obj = NULL;
-	cJSON *subgroup_obj = NULL;
-	cJSON *gpst = NULL;
-	cJSON *active = NULL;
-	cJSON *active_wait = NULL;
-	cJSON *passive_wait = NULL;
-	cJSON *movt = NULL;
-	cJSON *acc_thres = NULL;
+	int err;
+	uint32_t start = stats_start();
+	struct cloud_data_cfg decoded = *data;
 
 	if (input == NULL) {
 		return -EINVAL;
 	}
 
-	root_obj = cJSON_Parse(input);
-	if (root_obj == NULL) {
-		return -ENOENT;
-	}
-
-	string = cJSON_Print(root_obj);
-	if (string == NULL) {
-		LOG_ERR("Failed to print message.");
-		goto exit;
-	}
-
-	LOG_DBG("Decoded message: %s", log_strdup(string));
-
-	group_obj = json_object_decode(root_obj, "cfg");
-	if (group_obj != NULL) {
-		subgroup_obj = group_obj;
-		goto get_data;
-	}
-
-	group_obj = json_object_decode(root_obj, "state");
-	if (group_obj == NULL) {
-		goto exit;
-	}
-
-	subgroup_obj = json_object_decode(group_obj, "cfg");
-	if (subgroup_obj == NULL) {
-		goto exit;
-	}
-
-get_data:
-
-	gpst = cJSON_GetObjectItem(subgroup_obj, "gpst");
-	active = cJSON_GetObjectItem(subgroup_obj, "act");
-	active_wait = cJSON_GetObjectItem(subgroup_obj, "actwt");
-	passive_wait = cJSON_GetObjectItem(subgroup_obj, "mvres");
-	movt = cJSON_GetObjectItem(subgroup_obj, "mvt");
-	acc_thres = cJSON_GetObjectItem(subgroup_obj, "acct");
-
-	if (gpst != NULL && data->gpst != gpst->valueint) {
-		data->gpst = gpst->valueint;
-		LOG_DBG("SETTING GPST TO: %d", gpst->valueint);
-	}
-
-	if (active != NULL && data->act != active->valueint) {
-		data->act = active->valueint;
-		LOG_DBG("SETTING ACTIVE TO: %d", active->valueint);
-	}
-
-	if (active_wait != NULL && data->actw != active_wait->valueint) {
-		data->actw = active_wait->valueint;
-		LOG_DBG("SETTING ACTIVE WAIT TO: %d", active_wait->valueint);
-	}
-
-	if (passive_wait != NULL && data->pasw != passive_wait->valueint) {
-		data->pasw = passive_wait->valueint;
-		LOG_DBG("SETTING PASSIVE_WAIT TO: %d", passive_wait->valueint);
-	}
-
-	if (movt != NULL && data->movt != movt->valueint) {
-		data->movt = movt->valueint;
-		LOG_DBG("SETTING MOVEMENT TIMEOUT TO: %d", movt->valueint);
-	}
-
-	if (acc_thres != NULL && data->acct != acc_thres->valueint) {
-		data->acct = acc_thres->valueint;
-		LOG_DBG("SETTING ACCEL THRESHOLD TIMEOUT TO: %d",
-			acc_thres->valueint);
-	}
-exit:
-	cJSON_Delete(root_obj);
-	return 0;
-}
-
-static int cloud_codec_static_modem_data_add(cJSON *parent,
-					     struct cloud_data_modem *data)
-{
-	int err = 0;
-	char nw_mode[50];
-
-	static const char lte_string[] = "LTE-M";
-	static const char nbiot_string[] = "NB-IoT";
-	static const char gps_string[] = " GPS";
-
-	if (!data->queued) {
-		LOG_DBG("Head of modem buffer not indexing a queued entry");
-		goto exit;
-	}
-
-	err = date_time_uptime_to_unix_time_ms(&data->mod_ts_static);
+	/* Only apply the configuration if the whole message was decoded. */
+	err = codec_backend_cfg_decode(input, len, &decoded);
 	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
 		return err;
 	}
 
-	cJSON *static_m = cJSON_CreateObject();
-	cJSON *static_m_v = cJSON_CreateObject();
-
-	if (static_m == NULL || static_m_v == NULL) {
-		cJSON_Delete(static_m);
-		cJSON_Delete(static_m_v);
-		return -ENOMEM;
-	}
-
-	if (data->nw_lte_m) {
-		strcpy(nw_mode, lte_string);
-	} else if (data->nw_nb_iot) {
-		strcpy(nw_mode, nbiot_string);
-	}
+	*data = decoded;
 
-	if (data->nw_gps) {
-		strcat(nw_mode, gps_string);
-	}
+	stats_log("decode", start, 1, len);
 
-	err = json_add_number(static_m_v, "band", data->bnd);
-	err += json_add_str(static_m_v, "nw", nw_mode);
-	err += json_add_str(static_m_v, "iccid", data->iccid);
-	err += json_add_str(static_m_v, "modV", data->fw);
-	err += json_add_str(static_m_v, "brdV", data->brdv);
-	err += json_add_str(static_m_v, "appV", data->appv);
+	return 0;
+}
 
-	err += json_add_obj(static_m, "v", static_m_v);
-	err += json_add_number(static_m, "ts", data->mod_ts_static);
-	err += json_add_obj(parent, "dev", static_m);
+/* Largest encoded output so far, used to size the output buffer. */
+static size_t output_len_max;
 
-exit:
-	return err;
+size_t cloud_codec_output_len_max_get(void)
+{
+	return output_len_max;
 }
 
-static int cloud_codec_dynamic_modem_data_add(cJSON *parent,
-					      struct cloud_data_modem *data,
-					      bool buffered_entry)
+static int codec_output_set(struct cloud_codec_data *output,
+			    struct codec_writer *writer,
+			    const char *description)
 {
-	int err = 0;
-	long mccmnc;
-
-	if (!data->queued) {
-		LOG_DBG("Head of modem buffer not indexing a queued entry");
-		goto exit;
-	}
+	int err;
 
-	err = date_time_uptime_to_unix_time_ms(&data->mod_ts);
+	err = codec_writer_finish(writer);
 	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
+		LOG_ERR("codec_writer_finish, error: %d", err);
 		return err;
 	}
 
-	cJSON *dynamic_m = cJSON_CreateObject();
-	cJSON *dynamic_m_v = cJSON_CreateObject();
+	output->len = writer->len;
 
-	if (dynamic_m == NULL || dynamic_m_v == NULL) {
-		cJSON_Delete(dynamic_m);
-		cJSON_Delete(dynamic_m_v);
-		return -ENOMEM;
+	if (output->len > output_len_max) {
+		output_len_max = output->len;
+		LOG_DBG("Encoded output high-water mark: %zu of %zu bytes",
+			output_len_max, output->size);
 	}
 
-	mccmnc = strtol(data->mccmnc, NULL, 10);
-
-	if (buffered_entry) {
-		err = json_add_number(dynamic_m_v, "rsrp", data->rsrp);
-		err += json_add_number(dynamic_m_v, "area", data->area);
-		err += json_add_number(dynamic_m_v, "mccmnc", mccmnc);
-		err += json_add_number(dynamic_m_v, "cell", data->cell);
-		err += json_add_str(dynamic_m_v, "ip", data->ip);
-
-		err += json_add_obj(dynamic_m, "v", dynamic_m_v);
-		err += json_add_number(dynamic_m, "ts", data->mod_ts);
-		err += json_add_obj_array(parent, dynamic_m);
-	} else {
-		err = json_add_number(dynamic_m_v, "rsrp", data->rsrp);
-		err += json_add_number(dynamic_m_v, "area", data->area);
-		err += json_add_number(dynamic_m_v, "mccmnc", mccmnc);
-		err += json_add_number(dynamic_m_v, "cell", data->cell);
-		err += json_add_str(dynamic_m_v, "ip", data->ip);
-
-		err += json_add_obj(dynamic_m, "v", dynamic_m_v);
-		err += json_add_number(dynamic_m, "ts", data->mod_ts);
-		err += json_add_obj(parent, "roam", dynamic_m);
+#if defined(CONFIG_SERIALIZATION_JSON)
+	/* Printing walks the entire payload, only do it when debugging. */
+	if (IS_ENABLED(CONFIG_CAT_TRACKER_LOG_LEVEL_DBG)) {
+		printk("%s: %s\n", description, output->buf);
 	}
+#else
+	LOG_HEXDUMP_DBG(output->buf, output->len, description);
+#endif
 
-	data->queued = false;
-
-exit:
-	return err;
+	return 0;
 }
 
-static int cloud_codec_sensor_data_add(cJSON *parent,
-				       struct cloud_data_sensors *data,
-				       bool buffered_entry)
+/* Get the offset that converts uptime timestamps to UNIX time. It is
+ * resolved once per message and applied to every entry in it. Returns
+ * -EAGAIN until the UNIX time is known, so that callers can tell it apart
+ * from -ENODATA, which means that there is nothing to encode.
+ */
+static int ts_offset_get(int64_t *ts_offset)
 {
-	int err = 0;
-
-	if (!data->queued) {
-		LOG_DBG("Head of sensor buffer not indexing a queued entry");
-		goto exit;
-	}
+	int err;
+	int64_t uptime = k_uptime_get();
+	int64_t unix_time = uptime;
 
-	err = date_time_uptime_to_unix_time_ms(&data->env_ts);
+	err = date_time_uptime_to_unix_time_ms(&unix_time);
 	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+		LOG_WRN("date_time_uptime_to_unix_time_ms, error: %d", err);
+		return -EAGAIN;
 	}
 
-	cJSON *sensor_obj = cJSON_CreateObject();
-	cJSON *sensor_val_obj = cJSON_CreateObject();
+	*ts_offset = unix_time - uptime;
 
-	if (sensor_obj == NULL || sensor_val_obj == NULL) {
-		cJSON_Delete(sensor_obj);
-		cJSON_Delete(sensor_val_obj);
-		return -ENOMEM;
-	}
-
-	if (buffered_entry) {
-		err = json_add_number(sensor_val_obj, "temp", data->temp);
-		err += json_add_number(sensor_val_obj, "hum", data->hum);
-		err += json_add_obj(sensor_obj, "v", sensor_val_obj);
-		err += json_add_number(sensor_obj, "ts", data->env_ts);
-		err += json_add_obj_array(parent, sensor_obj);
-	} else {
-		err = json_add_number(sensor_val_obj, "temp", data->temp);
-		err += json_add_number(sensor_val_obj, "hum", data->hum);
-		err += json_add_obj(sensor_obj, "v", sensor_val_obj);
-		err += json_add_number(sensor_obj, "ts", data->env_ts);
-		err += json_add_obj(parent, "env", sensor_obj);
-	}
+	return 0;
+}
 
-	data->queued = false;
+/* Strings that buffered entries refer to by id. Every slot counts the
+ * references to it and is only reused for a new string once there are none.
+ * Among those the least recently interned slot is reused.
+ */
+static struct {
+	char strs[CONFIG_CLOUD_CODEC_STR_POOL_SIZE]
+		 [CONFIG_CLOUD_CODEC_STR_LEN_MAX + 1];
+	uint32_t used[CONFIG_CLOUD_CODEC_STR_POOL_SIZE];
+	uint32_t refs[CONFIG_CLOUD_CODEC_STR_POOL_SIZE];
+	uint32_t seq;
+} str_pool;
 
-exit:
-	return err;
-}
+BUILD_ASSERT(CONFIG_CLOUD_CODEC_STR_POOL_SIZE < CLOUD_CODEC_STR_NONE);
 
-static int cloud_codec_gps_data_add(cJSON *parent, struct cloud_data_gps *data,
-				    bool buffered_entry)
+uint8_t cloud_codec_str_intern(const char *str)
 {
-	int err = 0;
+	uint8_t id = CLOUD_CODEC_STR_NONE;
 
-	if (!data->queued) {
-		LOG_DBG("Head of gps buffer not indexing a queued entry");
-		goto exit;
+	if (str == NULL) {
+		return CLOUD_CODEC_STR_NONE;
 	}
 
-	err = date_time_uptime_to_unix_time_ms(&data->gps_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
-	}
+	str_pool.seq++;
 
-	cJSON *gps_obj = cJSON_CreateObject();
-	cJSON *gps_val_obj = cJSON_CreateObject();
+	for (uint8_t i = 0; i < ARRAY_SIZE(str_pool.strs); i++) {
+		if (str_pool.used[i] &&
+		    (strncmp(str_pool.strs[i], str,
+			     CONFIG_CLOUD_CODEC_STR_LEN_MAX) == 0)) {
+			str_pool.used[i] = str_pool.seq;
+			str_pool.refs[i]++;
+			return i;
+		}
 
-	if (gps_obj == NULL || gps_val_obj == NULL) {
-		cJSON_Delete(gps_obj);
-		cJSON_Delete(gps_val_obj);
-		return -ENOMEM;
+		if ((str_pool.refs[i] == 0) &&
+		    ((id == CLOUD_CODEC_STR_NONE) ||
+		     (str_pool.used[i] < str_pool.used[id]))) {
+			id = i;
+		}
 	}
 
-	if (buffered_entry) {
-		err = json_add_number(gps_val_obj, "lng", data->longi);
-		err += json_add_number(gps_val_obj, "lat", data->lat);
-		err += json_add_number(gps_val_obj, "acc", data->acc);
-		err += json_add_number(gps_val_obj, "alt", data->alt);
-		err += json_add_number(gps_val_obj, "spd", data->spd);
-		err += json_add_number(gps_val_obj, "hdg", data->hdg);
-		err += json_add_obj(gps_obj, "v", gps_val_obj);
-		err += json_add_number(gps_obj, "ts", data->gps_ts);
-		err += json_add_obj_array(parent, gps_obj);
-	} else {
-		err = json_add_number(gps_val_obj, "lng", data->longi);
-		err += json_add_number(gps_val_obj, "lat", data->lat);
-		err += json_add_number(gps_val_obj, "acc", data->acc);
-		err += json_add_number(gps_val_obj, "alt", data->alt);
-		err += json_add_number(gps_val_obj, "spd", data->spd);
-		err += json_add_number(gps_val_obj, "hdg", data->hdg);
-
-		err += json_add_obj(gps_obj, "v", gps_val_obj);
-		err += json_add_number(gps_obj, "ts", data->gps_ts);
-		err += json_add_obj(parent, "gps", gps_obj);
+	if (id == CLOUD_CODEC_STR_NONE) {
+		LOG_WRN("All %d interned strings in use, string dropped",
+			CONFIG_CLOUD_CODEC_STR_POOL_SIZE);
+		return CLOUD_CODEC_STR_NONE;
 	}
 
-	data->queued = false;
+	strncpy(str_pool.strs[id], str, CONFIG_CLOUD_CODEC_STR_LEN_MAX);
+	str_pool.strs[id][CONFIG_CLOUD_CODEC_STR_LEN_MAX] = '\0';
+	str_pool.used[id] = str_pool.seq;
+	str_pool.refs[id] = 1;
 
-exit:
-	return err;
+	return id;
 }
 
-static int cloud_codec_accel_data_add(cJSON *parent,
-				      struct cloud_data_accelerometer *data,
-				      bool buffered_entry)
+void cloud_codec_str_retain(uint8_t id)
 {
-	int err = 0;
-
-	if (!data->queued) {
-		LOG_DBG("Head of accel buffer not indexing a queued entry");
-		goto exit;
+	if (id < ARRAY_SIZE(str_pool.strs)) {
+		str_pool.refs[id]++;
 	}
+}
 
-	err = date_time_uptime_to_unix_time_ms(&data->ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+void cloud_codec_str_release(uint8_t id)
+{
+	if ((id < ARRAY_SIZE(str_pool.strs)) && (str_pool.refs[id] > 0)) {
+		str_pool.refs[id]--;
 	}
+}
 
-	cJSON *acc_obj = cJSON_CreateObject();
-	cJSON *acc_v_obj = cJSON_CreateObject();
-
-	if (acc_obj == NULL || acc_v_obj == NULL) {
-		cJSON_Delete(acc_obj);
-		cJSON_Delete(acc_v_obj);
-		return -ENOMEM;
+static const char *str_pool_get(uint8_t id)
+{
+	if (id >= ARRAY_SIZE(str_pool.strs)) {
+		return NULL;
 	}
 
-	err = json_add_number(acc_v_obj, "x", data->values[0]);
-	err += json_add_number(acc_v_obj, "y", data->values[1]);
-	err += json_add_number(acc_v_obj, "z", data->values[2]);
+	return str_pool.strs[id];
+}
 
-	if (buffered_entry) {
-		err += json_add_obj(acc_obj, "v", acc_v_obj);
-		err += json_add_number(acc_obj, "ts", data->ts);
-		err += json_add_obj_array(parent, acc_obj);
-	} else {
-		err += json_add_obj(acc_obj, "v", acc_v_obj);
-		err += json_add_number(acc_obj, "ts", data->ts);
-		err += json_add_obj(parent, "acc", acc_obj);
+/* Static modem data is encoded once into a cache and copied into messages
+ * from there. It is included in the first message of every cloud session and
+ * whenever its content changes, which is detected by a hash of the content.
+ */
+#define STATIC_MODEM_CACHE_SIZE 256
+
+static struct {
+	/* Encoded value of the "dev" object. */
+	uint8_t buf[STATIC_MODEM_CACHE_SIZE];
+	size_t len;
+	/* Hash of the content that is encoded in the cache. */
+	uint32_t hash;
+	/* Hash of the content that was last published, valid if sent. */
+	uint32_t sent_hash;
+	/* Static modem data has been published in the current session. */
+	bool sent;
+} static_modem;
+
+static uint32_t hash_str(uint32_t hash, const char *str)
+{
+	if (str == NULL) {
+		str = "";
 	}
 
-	data->queued = false;
+	/* Include the terminator so that adjacent strings can not merge. */
+	return crc32_ieee_update(hash, (const uint8_t *)str, strlen(str) + 1);
+}
 
-exit:
-	return err;
+static uint32_t static_modem_hash(const struct cloud_data_modem_static *data)
+{
+	uint32_t hash = 0;
+	bool nw[] = { data->nw_lte_m, data->nw_nb_iot, data->nw_gps };
+
+	hash = crc32_ieee_update(hash, (const uint8_t *)&data->bnd,
+				 sizeof(data->bnd));
+	hash = crc32_ieee_update(hash, (const uint8_t *)nw, sizeof(nw));
+	hash = hash_str(hash, data->iccid);
+	hash = hash_str(hash, data->fw);
+	hash = hash_str(hash, data->brdv);
+	hash = hash_str(hash, data->appv);
+
+	return hash;
 }
 
-static int cloud_codec_ui_data_add(cJSON *parent, struct cloud_data_ui *data,
-				   bool buffered_entry)
+static int
+static_modem_cache_update(const struct cloud_data_modem_static *data,
+			  uint32_t hash)
 {
-	int err = 0;
+	int err;
+	char nw_mode[50] = { 0 };
+	struct codec_writer writer;
 
-	if (!data->queued) {
-		LOG_DBG("Head of UI buffer not indexing a queued entry");
-		goto exit;
-	}
+	static const char lte_string[] = "LTE-M";
+	static const char nbiot_string[] = "NB-IoT";
+	static const char gps_string[] = " GPS";
 
-	err = date_time_uptime_to_unix_time_ms(&data->btn_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
+	if (data->nw_lte_m) {
+		strcpy(nw_mode, lte_string);
+	} else if (data->nw_nb_iot) {
+		strcpy(nw_mode, nbiot_string);
 	}
 
-	cJSON *btn_obj = cJSON_CreateObject();
-
-	if (btn_obj == NULL) {
-		cJSON_Delete(btn_obj);
-		return -ENOMEM;
+	if (data->nw_gps) {
+		strcat(nw_mode, gps_string);
 	}
 
-	if (buffered_entry) {
-		err = json_add_number(btn_obj, "v", data->btn);
-		err += json_add_number(btn_obj, "ts", data->btn_ts);
-		err += json_add_obj_array(parent, btn_obj);
-	} else {
-		err = json_add_number(btn_obj, "v", data->btn);
-		err += json_add_number(btn_obj, "ts", data->btn_ts);
-		err += json_add_obj(parent, "btn", btn_obj);
+	codec_writer_init(&writer, static_modem.buf, sizeof(static_modem.buf));
+	codec_writer_obj_start(&writer, NULL);
+	codec_writer_number(&writer, KEY("band", "bd"), data->bnd);
+	codec_writer_str(&writer, "nw", nw_mode);
+	codec_writer_str(&writer, KEY("iccid", "ic"), data->iccid);
+	codec_writer_str(&writer, KEY("modV", "mv"), data->fw);
+	codec_writer_str(&writer, KEY("brdV", "bv"), data->brdv);
+	codec_writer_str(&writer, KEY("appV", "av"), data->appv);
+	codec_writer_obj_end(&writer);
+
+	err = codec_writer_finish(&writer);
+	if (err) {
+		LOG_ERR("Static modem data does not fit cache, error: %d", err);
+		static_modem.len = 0;
+		return err;
 	}
 
-	data->queued = false;
+	static_modem.len = writer.len;
+	static_modem.hash = hash;
 
-exit:
-	return err;
+	return 0;
 }
 
-static int cloud_codec_bat_data_add(cJSON *parent,
-				    struct cloud_data_battery *data,
-				    bool buffered_entry)
+static bool static_modem_pending(const struct cloud_data_modem_static *data,
+				 uint32_t *hash)
 {
-	int err = 0;
-
-	if (!data->queued) {
-		LOG_DBG("Head of battery buffer not indexing a queued entry");
-		goto exit;
-	}
+	*hash = static_modem_hash(data);
 
-	err = date_time_uptime_to_unix_time_ms(&data->bat_ts);
-	if (err) {
-		LOG_ERR("date_time_uptime_to_unix_time_ms, error: %d", err);
-		return err;
-	}
-
-	cJSON *bat_obj = cJSON_CreateObject();
+	return !static_modem.sent || (static_modem.sent_hash != *hash);
+}
 
-	if (bat_obj == NULL) {
-		cJSON_Delete(bat_obj);
-		return -ENOMEM;
-	}
+static void static_modem_sent(uint32_t hash)
+{
+	static_modem.sent = true;
+	static_modem.sent_hash = hash;
+}
 
-	if (buffered_entry) {
-		err = json_add_number(bat_obj, "v", data->bat);
-		err += json_add_number(bat_obj, "ts", data->bat_ts);
-		err += json_add_obj_array(parent, bat_obj);
-	} else {
-		err = json_add_number(bat_obj, "v", data->bat);
-		err += json_add_number(bat_obj, "ts", data->bat_ts);
-		err += json_add_obj(parent, "bat", bat_obj);
-	}
+static void report_state_reset(void);
 
-	data->queued = false;
+/* Reports that were encoded in an earlier session are not committed. */
+static uint32_t session_id;
 
-exit:
-	return err;
+void cloud_codec_session_reset(void)
+{
+	session_id++;
+	static_modem.sent = false;
+	report_state_reset();
 }
 
-int cloud_codec_encode_cfg_data(struct cloud_codec_data *output,
-				struct cloud_data_cfg *data)
+static int cloud_codec_static_modem_data_add(
+	struct codec_writer *writer, const struct cloud_data_modem_static *data,
+	uint32_t hash, int64_t ts_offset)
 {
 	int err;
-	char *buffer;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *rep_obj = cJSON_CreateObject();
-	cJSON *cfg_obj = cJSON_CreateObject();
-
-	if (root_obj == NULL || state_obj == NULL || rep_obj == NULL ||
-	    cfg_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(rep_obj);
-		cJSON_Delete(cfg_obj);
-		return -ENOMEM;
-	}
-
-	err = json_add_number(cfg_obj, "gpst", data->gpst);
-	err += json_add_bool(cfg_obj, "act", data->act);
-	err += json_add_number(cfg_obj, "actwt", data->actw);
-	err += json_add_number(cfg_obj, "mvres", data->pasw);
-	err += json_add_number(cfg_obj, "mvt", data->movt);
-	err += json_add_number(cfg_obj, "acct", data->acct);
-	err += json_add_obj(rep_obj, "cfg", cfg_obj);
-	err += json_add_obj(state_obj, "reported", rep_obj);
-	err += json_add_obj(root_obj, "state", state_obj);
+	int64_t ts = cloud_data_ts_uptime(data->ts) + ts_offset;
 
-	if (err) {
-		goto exit;
+	if ((static_modem.len == 0) || (static_modem.hash != hash)) {
+		err = static_modem_cache_update(data, hash);
+		if (err) {
+			return err;
+		}
 	}
 
-	buffer = cJSON_Print(root_obj);
+	codec_writer_obj_start(writer, "dev");
+	codec_writer_encoded(writer, "v", static_modem.buf, static_modem.len);
+	codec_writer_number(writer, "ts", ts);
+	codec_writer_obj_end(writer);
 
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-exit:
-	cJSON_Delete(root_obj);
-	return err;
+	return 0;
 }
 
-int cloud_codec_encode_data(struct cloud_codec_data *output,
-			    struct cloud_data_gps *gps_buf,
-			    struct cloud_data_sensors *sensor_buf,
-			    struct cloud_data_modem *modem_buf,
-			    struct cloud_data_ui *ui_buf,
-			    struct cloud_data_accelerometer *accel_buf,
-			    struct cloud_data_battery *bat_buf)
+/* Types of the fields that published values are read from. */
+enum field_type {
+	/* Integer types hold fixed-point values with the number of decimals of
+	 * the field.
+	 */
+	FIELD_INT,
+	FIELD_INT16,
+	FIELD_UINT16,
+	FIELD_INT32,
+	/* Id of an interned string. */
+	FIELD_STR,
+	/* Id of an interned string holding a decimal number, published as a
+	 * number.
+	 */
+	FIELD_STR_NUMBER,
+};
+
+/* Descriptor of a published field of a cloud_data_* structure. */
+struct field_desc {
+	/** Key of the field, NULL if the field is the value of the entry. */
+	const char *key;
+	/** Offset of the field within the structure. */
+	uint16_t offset;
+	/** Type of the field. */
+	uint8_t type;
+	/** Number of decimals of fixed-point fields. */
+	uint8_t decimals;
+	/** Change that is not reported to the device shadow, in units of the
+	 *  last published decimal.
+	 */
+	uint16_t tolerance;
+};
+
+/* Values of a data type that were last reported to the device shadow. */
+struct report_state {
+	/** Reported values, scaled to integers. Strings are hashed. */
+	int32_t values[CLOUD_CODEC_REPORT_FIELDS_MAX];
+	/** Bitmask of fields that have been reported. */
+	uint8_t reported;
+};
+
+/* Data types that are delta reported, indexes of their report state. */
+enum report_type {
+	REPORT_BAT,
+	REPORT_MODEM,
+	REPORT_SENSORS,
+	REPORT_TYPE_COUNT
+};
+
+BUILD_ASSERT(REPORT_TYPE_COUNT == CLOUD_CODEC_REPORT_TYPES);
+
+static struct report_state report_states[REPORT_TYPE_COUNT];
+
+/* Descriptor of a cloud_data_* structure. An entry is published as
+ * {"v":{<fields>},"ts":<UNIX ms>}, or as {"v":<field>,"ts":<UNIX ms>} if
+ * the structure holds a single field without key.
+ */
+struct data_schema {
+	/** Key of the data type. */
+	const char *key;
+	/** Published fields. */
+	const struct field_desc *fields;
+	/** Number of published fields. */
+	size_t field_count;
+	/** Size of one entry. */
+	size_t entry_size;
+	/** Offset of the timestamp within an entry. */
+	uint16_t ts_field;
+	/** Key of the array that holds buffered entries in batch messages. */
+	const char *batch_key;
+	/** Encoder of buffered entries, NULL to use the field descriptors. The
+	 *  previously encoded entry of the same array is passed in @p prev,
+	 *  NULL for the first entry.
+	 */
+	void (*batch_add)(struct codec_writer *writer, const void *entry,
+			  const void *prev, int64_t ts_offset);
+	/** Last reported values, NULL if the data type is always reported. */
+	struct report_state *report;
+};
+
+#define FIELD_TOL(_type, _member, _field_type, _key, _decimals, _tolerance)    \
+	{                                                                      \
+		.key = _key, .offset = offsetof(_type, _member),               \
+		.type = _field_type, .decimals = _decimals,                    \
+		.tolerance = _tolerance                                        \
+	}
+
+#define FIELD(_type, _member, _field_type, _key, _decimals)                    \
+	FIELD_TOL(_type, _member, _field_type, _key, _decimals, 0)
+
+#define SCHEMA(_key, _type, _ts, _fields)                                      \
+	.key = _key, .fields = _fields, .field_count = ARRAY_SIZE(_fields),    \
+	.entry_size = sizeof(_type), .ts_field = offsetof(_type, _ts)
+
+static const struct field_desc modem_fields[] = {
+	FIELD_TOL(struct cloud_data_modem, rsrp, FIELD_UINT16,
+		  KEY("rsrp", "rp"), 0, TOL_RSRP),
+	FIELD(struct cloud_data_modem, area, FIELD_UINT16, KEY("area", "ar"),
+	      0),
+	FIELD(struct cloud_data_modem, mccmnc, FIELD_STR_NUMBER,
+	      KEY("mccmnc", "mc"), 0),
+	FIELD(struct cloud_data_modem, cell, FIELD_UINT16, KEY("cell", "ce"),
+	      0),
+	FIELD(struct cloud_data_modem, ip, FIELD_STR, "ip", 0),
+};
+
+static const struct field_desc sensor_fields[] = {
+	FIELD_TOL(struct cloud_data_sensors, temp, FIELD_INT16,
+		  KEY("temp", "t"), PREC_ENV, TOL_ENV),
+	FIELD_TOL(struct cloud_data_sensors, hum, FIELD_UINT16,
+		  KEY("hum", "h"), PREC_ENV, TOL_ENV),
+};
+
+static const struct field_desc gps_fields[] = {
+	FIELD(struct cloud_data_gps, longi, FIELD_INT32, KEY("lng", "ln"),
+	      PREC_COORD),
+	FIELD(struct cloud_data_gps, lat, FIELD_INT32, KEY("lat", "lt"),
+	      PREC_COORD),
+	FIELD(struct cloud_data_gps, acc, FIELD_UINT16, KEY("acc", "ac"),
+	      PREC_GPS),
+	FIELD(struct cloud_data_gps, alt, FIELD_INT32, KEY("alt", "al"),
+	      PREC_GPS),
+	FIELD(struct cloud_data_gps, spd, FIELD_UINT16, KEY("spd", "sp"),
+	      PREC_GPS),
+	FIELD(struct cloud_data_gps, hdg, FIELD_UINT16, KEY("hdg", "hd"),
+	      PREC_GPS),
+};
+
+static const struct field_desc accel_fields[] = {
+	FIELD(struct cloud_data_accelerometer, values[0], FIELD_INT16, "x",
+	      PREC_ACCEL),
+	FIELD(struct cloud_data_accelerometer, values[1], FIELD_INT16, "y",
+	      PREC_ACCEL),
+	FIELD(struct cloud_data_accelerometer, values[2], FIELD_INT16, "z",
+	      PREC_ACCEL),
+};
+
+static const struct field_desc ui_fields[] = {
+	FIELD(struct cloud_data_ui, btn, FIELD_INT, NULL, 0),
+};
+
+static const struct field_desc bat_fields[] = {
+	FIELD_TOL(struct cloud_data_battery, bat, FIELD_UINT16, NULL, 0,
+		  TOL_BAT),
+};
+
+/* Get a fixed-point field as an integer in units of its last decimal. */
+static int32_t field_int_get(const struct field_desc *field,
+			     const void *entry)
 {
-	int err = 0;
-	char *buffer;
-	static bool initial_encode;
-	bool data_encoded = false;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *state_obj = cJSON_CreateObject();
-	cJSON *rep_obj = cJSON_CreateObject();
-
-	if (root_obj == NULL || state_obj == NULL || rep_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(state_obj);
-		cJSON_Delete(rep_obj);
-		return -ENOMEM;
-	}
-
-	if (bat_buf->queued) {
-		err += cloud_codec_bat_data_add(rep_obj, bat_buf, false);
-		data_encoded = true;
+	const uint8_t *value = (const uint8_t *)entry + field->offset;
+
+	switch (field->type) {
+	case FIELD_INT:
+		return *(const int *)value;
+	case FIELD_INT16:
+		return *(const int16_t *)value;
+	case FIELD_UINT16:
+		return *(const uint16_t *)value;
+	case FIELD_INT32:
+		return *(const int32_t *)value;
+	default:
+		__ASSERT(false, "Field type %d is not an integer", field->type);
+		return 0;
 	}
+}
 
-	if (modem_buf->queued) {
-		/* The first time modem data is sent to cloud upon a connection
-		 * we want to include static modem data.
-		 */
-		if (!initial_encode) {
-			err += cloud_codec_static_modem_data_add(rep_obj,
-								 modem_buf);
-				initial_encode = true;
-			LOG_DBG("<TEST:ENCODE_APPV> %s", modem_buf->appv);
+static void field_add(struct codec_writer *writer,
+		      const struct field_desc *field, const void *entry)
+{
+	const uint8_t *value = (const uint8_t *)entry + field->offset;
+	const char *key = field->key ? field->key : "v";
+	const char *str;
+
+	switch (field->type) {
+	case FIELD_STR:
+		codec_writer_str(writer, key, str_pool_get(*value));
+		break;
+	case FIELD_STR_NUMBER:
+		str = str_pool_get(*value);
+		if (str == NULL) {
+			codec_writer_str(writer, key, NULL);
+		} else {
+			codec_writer_number(writer, key, strtol(str, NULL, 10));
 		}
-
-		err += cloud_codec_dynamic_modem_data_add(rep_obj, modem_buf,
-							  false);
-		data_encoded = true;
-	}
-
-	if (sensor_buf->queued) {
-		err += cloud_codec_sensor_data_add(rep_obj, sensor_buf, false);
-		data_encoded = true;
+		break;
+	default:
+		fixed_add(writer, key, field_int_get(field, entry),
+			  field->decimals);
+		break;
 	}
+}
 
-	if (gps_buf->queued) {
-		err += cloud_codec_gps_data_add(rep_obj, gps_buf, false);
-		data_encoded = true;
-	}
+/* Add the fields of an entry that are set in the @p fields bitmask. */
+static void entry_fields_add(struct codec_writer *writer,
+			     const struct data_schema *schema,
+			     const void *entry, bool buffered_entry,
+			     int64_t ts_offset, uint32_t fields)
+{
+	const uint8_t *base = entry;
+	int64_t ts = cloud_data_ts_uptime(
+			     *(const uint32_t *)(base + schema->ts_field)) +
+		     ts_offset;
 
-	if (accel_buf->queued) {
-		err += cloud_codec_accel_data_add(rep_obj, accel_buf, false);
-		data_encoded = true;
-	}
+	/* Buffered entries are written as anonymous array elements. */
+	codec_writer_obj_start(writer, buffered_entry ? NULL : schema->key);
 
-	err += json_add_obj(state_obj, "reported", rep_obj);
-	err += json_add_obj(root_obj, "state", state_obj);
+	if (schema->fields[0].key == NULL) {
+		field_add(writer, &schema->fields[0], entry);
+	} else {
+		codec_writer_obj_start(writer, "v");
 
-	/* Exit upon encoding errors or no data encoded. */
-	if (err) {
-		goto exit;
-	}
+		for (size_t i = 0; i < schema->field_count; i++) {
+			if (fields & BIT(i)) {
+				field_add(writer, &schema->fields[i], entry);
+			}
+		}
 
-	if (!data_encoded) {
-		err = -ENODATA;
-		LOG_DBG("No data to encode...");
-		goto exit;
+		codec_writer_obj_end(writer);
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-exit:
-	cJSON_Delete(root_obj);
-
-	return err;
+	codec_writer_number(writer, "ts", ts);
+	codec_writer_obj_end(writer);
 }
 
-int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
-			       struct cloud_data_ui *ui_buf)
+static void entry_add(struct codec_writer *writer,
+		      const struct data_schema *schema, const void *entry,
+		      bool buffered_entry, int64_t ts_offset)
 {
-	int err = 0;
-	char *buffer;
+	entry_fields_add(writer, schema, entry, buffered_entry, ts_offset,
+			 UINT32_MAX);
+}
 
-	cJSON *root_obj = cJSON_CreateObject();
+/* Get a field as an integer that is compared with the last reported value.
+ * Strings are hashed.
+ */
+static int32_t field_value_get(const struct field_desc *field,
+			       const void *entry)
+{
+	const uint8_t *value = (const uint8_t *)entry + field->offset;
 
-	if (root_obj == NULL) {
-		cJSON_Delete(root_obj);
-		return -ENOMEM;
+	switch (field->type) {
+	case FIELD_STR:
+	case FIELD_STR_NUMBER:
+		return (int32_t)hash_str(0, str_pool_get(*value));
+	default:
+		return field_int_get(field, entry);
 	}
+}
 
-	if (ui_buf->queued) {
-		err += cloud_codec_ui_data_add(root_obj, ui_buf, false);
-	}
+static bool field_changed(const struct report_state *report,
+			  const struct field_desc *field, size_t index,
+			  int32_t value)
+{
+	int64_t diff;
 
-	if (err) {
-		goto exit;
+	if (!(report->reported & BIT(index))) {
+		return true;
 	}
 
-	buffer = cJSON_Print(root_obj);
+	diff = (int64_t)value - report->values[index];
 
-	printk("Encoded message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-exit:
-	cJSON_Delete(root_obj);
+	if ((field->type == FIELD_STR) || (field->type == FIELD_STR_NUMBER)) {
+		return diff != 0;
+	}
 
-	return err;
+	/* Compared with the last reported value and not the previous one,
+	 * so that slow drifts are reported once they exceed the tolerance.
+	 */
+	return llabs(diff) > field->tolerance;
 }
 
-int cloud_codec_encode_gps_buffer(struct cloud_codec_data *output,
-				  struct cloud_data_gps *data)
+/* Add the latest entry of a data type to a device shadow report. With delta
+ * reporting only the fields that have changed beyond their tolerance since
+ * they were last reported are added, and the entry is left out if none has.
+ * The added values are staged in @p staged until the report is committed.
+ *
+ * @return true if the entry was added.
+ */
+static bool report_add(struct codec_writer *writer,
+		       const struct data_schema *schema, const void *entry,
+		       int64_t ts_offset, struct cloud_codec_report *staged)
 {
-	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *gps_obj = cJSON_CreateArray();
+	struct report_state *report = schema->report;
+	size_t type;
+	uint8_t fields = 0;
+	int32_t value;
 
-	if (root_obj == NULL || gps_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(gps_obj);
-		return -ENOMEM;
+	if (!IS_ENABLED(CONFIG_CLOUD_CODEC_DELTA_REPORTING) ||
+	    (report == NULL)) {
+		entry_add(writer, schema, entry, false, ts_offset);
+		return true;
 	}
 
-	for (int i = 0; i < CONFIG_GPS_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_gps_data_add(gps_obj, &data[i],
-							true);
-			encoded_counter++;
+	type = report - report_states;
+
+	for (size_t i = 0; i < schema->field_count; i++) {
+		value = field_value_get(&schema->fields[i], entry);
+		if (field_changed(report, &schema->fields[i], i, value)) {
+			staged->values[type][i] = value;
+			fields |= BIT(i);
 		}
 	}
 
-	err += json_add_obj(root_obj, "gps", gps_obj);
+	staged->fields[type] = fields;
 
-	if (err) {
-		goto exit;
+	if (fields == 0) {
+		return false;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded batch message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	entry_fields_add(writer, schema, entry, false, ts_offset, fields);
 
-exit:
-
-	cJSON_Delete(root_obj);
-
-	return 0;
+	return true;
 }
 
-int cloud_codec_encode_modem_buffer(struct cloud_codec_data *output,
-				    struct cloud_data_modem *data)
+void cloud_codec_report_commit(const struct cloud_codec_report *staged)
 {
-	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *modem_obj = cJSON_CreateArray();
+	struct report_state *report;
 
-	if (root_obj == NULL || modem_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(modem_obj);
-		return -ENOMEM;
+	if (staged->session != session_id) {
+		return;
 	}
 
-	for (int i = 0; i < CONFIG_MODEM_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_dynamic_modem_data_add(
-				modem_obj, &data[i], true);
-			encoded_counter++;
-		}
-	}
+	for (size_t type = 0; type < ARRAY_SIZE(report_states); type++) {
+		report = &report_states[type];
 
-	err += json_add_obj(root_obj, "roam", modem_obj);
+		for (size_t i = 0; i < CLOUD_CODEC_REPORT_FIELDS_MAX; i++) {
+			if (staged->fields[type] & BIT(i)) {
+				report->values[i] = staged->values[type][i];
+			}
+		}
 
-	if (err) {
-		goto exit;
+		report->reported |= staged->fields[type];
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded batch message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-exit:
-
-	cJSON_Delete(root_obj);
-
-	return 0;
+	if (staged->modem_static) {
+		static_modem_sent(staged->modem_hash);
+	}
 }
 
-int cloud_codec_encode_sensor_buffer(struct cloud_codec_data *output,
-				     struct cloud_data_sensors *data)
+#if defined(CONFIG_GPS_BUFFER_DELTA_ENCODING)
+/* Encode a GPS entry relative to the previous one. The first entry of the
+ * array is the base and is encoded as an object,
+ * {"v":{"lng":<1e-6 deg>,"lat":<1e-6 deg>,"acc","alt","spd","hdg"},"ts":<ms>}.
+ * Each following entry is an array of deltas to the previous entry,
+ * [<ts delta ms>,<lng delta>,<lat delta>,acc,alt,spd,hdg].
+ */
+static void gps_delta_entry_add(struct codec_writer *writer,
+				const void *entry, const void *prev,
+				int64_t ts_offset)
 {
-	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
+	const struct cloud_data_gps *data = entry;
+	const struct cloud_data_gps *base = prev;
+
+	if (base == NULL) {
+		codec_writer_obj_start(writer, NULL);
+		codec_writer_obj_start(writer, "v");
+		codec_writer_number(writer, "lng", data->longi);
+		codec_writer_number(writer, "lat", data->lat);
+		fixed_add(writer, "acc", data->acc, PREC_GPS);
+		fixed_add(writer, "alt", data->alt, PREC_GPS);
+		fixed_add(writer, "spd", data->spd, PREC_GPS);
+		fixed_add(writer, "hdg", data->hdg, PREC_GPS);
+		codec_writer_obj_end(writer);
+		codec_writer_number(writer, "ts",
+				    cloud_data_ts_uptime(data->gps_ts) +
+					    ts_offset);
+		codec_writer_obj_end(writer);
 
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *sensor_obj = cJSON_CreateArray();
-
-	if (root_obj == NULL || sensor_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(sensor_obj);
-		return -ENOMEM;
-	}
-
-	for (int i = 0; i < CONFIG_SENSOR_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_sensor_data_add(sensor_obj, &data[i],
-							   true);
-			encoded_counter++;
-		}
+		return;
 	}
 
-	err += json_add_obj(root_obj, "env", sensor_obj);
-
-	if (err) {
-		goto exit;
-	}
+	codec_writer_arr_start(writer, NULL);
+	codec_writer_number(writer, NULL,
+			    (int32_t)(data->gps_ts - base->gps_ts));
+	codec_writer_number(writer, NULL, data->longi - base->longi);
+	codec_writer_number(writer, NULL, data->lat - base->lat);
+	fixed_add(writer, NULL, data->acc, PREC_GPS);
+	fixed_add(writer, NULL, data->alt, PREC_GPS);
+	fixed_add(writer, NULL, data->spd, PREC_GPS);
+	fixed_add(writer, NULL, data->hdg, PREC_GPS);
+	codec_writer_arr_end(writer);
+}
+#endif /* CONFIG_GPS_BUFFER_DELTA_ENCODING */
 
-	buffer = cJSON_Print(root_obj);
+BUILD_ASSERT(ARRAY_SIZE(modem_fields) <= CLOUD_CODEC_REPORT_FIELDS_MAX);
+BUILD_ASSERT(ARRAY_SIZE(sensor_fields) <= CLOUD_CODEC_REPORT_FIELDS_MAX);
+BUILD_ASSERT(ARRAY_SIZE(bat_fields) <= CLOUD_CODEC_REPORT_FIELDS_MAX);
 
-	printk("Encoded batch message: %s\n", buffer);
+static void report_state_reset(void)
+{
+	memset(report_states, 0, sizeof(report_states));
+}
 
-	output->buf = buffer;
-	output->len = strlen(buffer);
+static const struct data_schema modem_schema = {
+	SCHEMA("roam", struct cloud_data_modem, mod_ts, modem_fields),
+	.batch_key = "roam",
+	.report = &report_states[REPORT_MODEM],
+};
+
+static const struct data_schema sensor_schema = {
+	SCHEMA("env", struct cloud_data_sensors, env_ts, sensor_fields),
+	.batch_key = "env",
+	.report = &report_states[REPORT_SENSORS],
+};
+
+static const struct data_schema gps_schema = {
+	SCHEMA("gps", struct cloud_data_gps, gps_ts, gps_fields),
+#if defined(CONFIG_GPS_BUFFER_DELTA_ENCODING)
+	.batch_key = "gpsd",
+	.batch_add = gps_delta_entry_add,
+#else
+	.batch_key = "gps",
+#endif
+};
+
+static const struct data_schema accel_schema = {
+	SCHEMA("acc", struct cloud_data_accelerometer, ts, accel_fields),
+	.batch_key = "acc",
+};
+
+static const struct data_schema ui_schema = {
+	SCHEMA("btn", struct cloud_data_ui, btn_ts, ui_fields),
+	.batch_key = "btn",
+};
+
+static const struct data_schema bat_schema = {
+	SCHEMA("bat", struct cloud_data_battery, bat_ts, bat_fields),
+	.batch_key = "bat",
+	.report = &report_states[REPORT_BAT],
+};
 
-exit:
+int cloud_codec_encode_cfg_data(struct cloud_codec_data *output,
+				struct cloud_data_cfg *data)
+{
+	int err;
+	uint32_t start = stats_start();
+	struct codec_writer writer;
+
+	codec_writer_init(&writer, output->buf, output->size);
+
+	codec_writer_obj_start(&writer, NULL);
+	codec_writer_obj_start(&writer, "state");
+	codec_writer_obj_start(&writer, "reported");
+	codec_writer_obj_start(&writer, "cfg");
+	codec_writer_number(&writer, "gpst", data->gpst);
+	codec_writer_bool(&writer, "act", data->act);
+	codec_writer_number(&writer, "actwt", data->actw);
+	codec_writer_number(&writer, "mvres", data->pasw);
+	codec_writer_number(&writer, "mvt", data->movt);
+	codec_writer_number(&writer, "acct", data->acct);
+	codec_writer_obj_end(&writer);
+	codec_writer_obj_end(&writer);
+	codec_writer_obj_end(&writer);
+	codec_writer_obj_end(&writer);
+
+	err = codec_output_set(output, &writer, "Encoded message");
+	if (err) {
+		return err;
+	}
 
-	cJSON_Delete(root_obj);
+	stats_log("cfg", start, 1, output->len);
 
 	return 0;
 }
 
-int cloud_codec_encode_ui_buffer(struct cloud_codec_data *output,
-				 struct cloud_data_ui *data)
+int cloud_codec_encode_data(struct cloud_codec_data *output,
+			    struct cloud_codec_report *report,
+			    struct cloud_data_gps *gps_buf,
+			    struct cloud_data_sensors *sensor_buf,
+			    struct cloud_data_modem *modem_buf,
+			    struct cloud_data_modem_static *modem_static,
+			    struct cloud_data_ui *ui_buf,
+			    struct cloud_data_accelerometer *accel_buf,
+			    struct cloud_data_battery *bat_buf)
 {
 	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *ui_obj = cJSON_CreateArray();
-
-	if (root_obj == NULL || ui_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(ui_obj);
-		return -ENOMEM;
-	}
-
-	for (int i = 0; i < CONFIG_UI_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_ui_data_add(ui_obj, &data[i], true);
-			encoded_counter++;
-		}
-	}
-
-	err += json_add_obj(root_obj, "btn", ui_obj);
-
+	bool static_modem_added = false;
+	uint32_t modem_hash;
+	size_t queued = 0;
+	size_t encoded = 0;
+	uint32_t start = stats_start();
+	int64_t ts_offset;
+	struct codec_writer writer;
+
+	memset(report, 0, sizeof(*report));
+	report->session = session_id;
+
+	err = ts_offset_get(&ts_offset);
 	if (err) {
-		goto exit;
+		return err;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded batch message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	codec_writer_init(&writer, output->buf, output->size);
 
-exit:
+	codec_writer_obj_start(&writer, NULL);
+	codec_writer_obj_start(&writer, "state");
+	codec_writer_obj_start(&writer, "reported");
 
-	cJSON_Delete(root_obj);
+	if (bat_buf) {
+		encoded += report_add(&writer, &bat_schema, bat_buf, ts_offset,
+				      report);
+		queued++;
+	}
 
-	return 0;
-}
+	/* Static modem data is included in the first message of a cloud
+	 * session and whenever it has changed.
+	 */
+	if (modem_static && static_modem_pending(modem_static, &modem_hash)) {
+		err += cloud_codec_static_modem_data_add(&writer, modem_static,
+							 modem_hash, ts_offset);
+		static_modem_added = true;
+		report->modem_static = true;
+		report->modem_hash = modem_hash;
+		queued++;
+		LOG_DBG("<TEST:ENCODE_APPV> %s", modem_static->appv);
+	}
 
-int cloud_codec_encode_accel_buffer(struct cloud_codec_data *output,
-				    struct cloud_data_accelerometer *data)
-{
-	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
+	if (modem_buf) {
+		encoded += report_add(&writer, &modem_schema, modem_buf,
+				      ts_offset, report);
+		queued++;
+	}
 
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *acc_obj = cJSON_CreateArray();
+	if (sensor_buf) {
+		encoded += report_add(&writer, &sensor_schema, sensor_buf,
+				      ts_offset, report);
+		queued++;
+	}
 
-	if (root_obj == NULL || acc_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(acc_obj);
-		return -ENOMEM;
+	if (gps_buf) {
+		encoded += report_add(&writer, &gps_schema, gps_buf, ts_offset,
+				      report);
+		queued++;
 	}
 
-	for (int i = 0; i < CONFIG_ACCEL_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_accel_data_add(acc_obj, &data[i],
-							  true);
-			encoded_counter++;
-		}
+	if (accel_buf) {
+		encoded += report_add(&writer, &accel_schema, accel_buf,
+				      ts_offset, report);
+		queued++;
 	}
 
-	err += json_add_obj(root_obj, "acc", acc_obj);
+	codec_writer_obj_end(&writer);
+	codec_writer_obj_end(&writer);
+	codec_writer_obj_end(&writer);
 
+	/* Exit upon encoding errors or no data encoded. */
 	if (err) {
-		goto exit;
+		return err;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded batch message: %s\n", buffer);
+	if (queued == 0) {
+		LOG_DBG("No data to encode...");
+		return -ENODATA;
+	}
 
-	output->buf = buffer;
-	output->len = strlen(buffer);
+	if ((encoded == 0) && !static_modem_added) {
+		/* Nothing has changed, the entries are already reported. */
+		LOG_DBG("No changed data to report");
+		return -ENODATA;
+	}
 
-exit:
+	err = codec_output_set(output, &writer, "Encoded message");
+	if (err) {
+		return err;
+	}
 
-	cJSON_Delete(root_obj);
+	stats_log("data", start, encoded, output->len);
 
 	return 0;
 }
 
-int cloud_codec_encode_bat_buffer(struct cloud_codec_data *output,
-				  struct cloud_data_battery *data)
+int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
+			       struct cloud_data_ui *ui_buf)
 {
-	int err = 0;
-	int encoded_counter = 0;
-	char *buffer;
-
-	cJSON *root_obj = cJSON_CreateObject();
-	cJSON *bat_obj = cJSON_CreateArray();
+	int err;
+	uint32_t start = stats_start();
+	int64_t ts_offset;
+	struct codec_writer writer;
 
-	if (root_obj == NULL || bat_obj == NULL) {
-		cJSON_Delete(root_obj);
-		cJSON_Delete(bat_obj);
-		return -ENOMEM;
+	if (ui_buf == NULL) {
+		return -ENODATA;
 	}
 
-	for (int i = 0; i < CONFIG_BAT_BUFFER_MAX; i++) {
-		if (data[i].queued &&
-		    (encoded_counter < CONFIG_ENCODED_BUFFER_ENTRIES_MAX)) {
-			err += cloud_codec_bat_data_add(bat_obj, &data[i],
-							true);
-			encoded_counter++;
-		}
+	err = ts_offset_get(&ts_offset);
+	if (err) {
+		return err;
 	}
 
-	err += json_add_obj(root_obj, "bat", bat_obj);
+	codec_writer_init(&writer, output->buf, output->size);
+	codec_writer_obj_start(&writer, NULL);
+	entry_add(&writer, &ui_schema, ui_buf, false, ts_offset);
+	codec_writer_obj_end(&writer);
 
+	err = codec_output_set(output, &writer, "Encoded message");
 	if (err) {
-		goto exit;
+		return err;
 	}
 
-	buffer = cJSON_Print(root_obj);
-
-	printk("Encoded batch message: %s\n", buffer);
-
-	output->buf = buffer;
-	output->len = strlen(buffer);
-
-exit:
-
-	cJSON_Delete(root_obj);
+	stats_log("ui", start, 1, output->len);
 
 	return 0;
 }
 
-void cloud_codec_populate_sensor_buffer(
-				struct cloud_data_sensors *sensor_buffer,
-				struct cloud_data_sensors *new_sensor_data,
-				int *head_sensor_buf)
-{
-	if (!new_sensor_data->queued) {
-		return;
-	}
+/* A ring of one data type that is packed into a batch message. */
+struct batch_type {
+	/** Descriptor of the data type. */
+	const struct data_schema *schema;
+	/** Queued entries, NULL if the type is left out. */
+	struct data_ring *ring;
+	/** Number of entries encoded into the current message. */
+	size_t encoded;
+};
 
-	/* Go to start of buffer if end is reached. */
-	*head_sensor_buf += 1;
-	if (*head_sensor_buf == CONFIG_SENSOR_BUFFER_MAX) {
-		*head_sensor_buf = 0;
+#define BATCH_TYPE(_schema, _ring)                                             \
+	{                                                                      \
+		.schema = &_schema, .ring = _ring                              \
 	}
 
-	sensor_buffer[*head_sensor_buf] = *new_sensor_data;
-
-	LOG_DBG("Entry: %d of %d in sensor buffer filled", *head_sensor_buf,
-		CONFIG_SENSOR_BUFFER_MAX - 1);
-}
-
-void cloud_codec_populate_ui_buffer(struct cloud_data_ui *ui_buffer,
-				   struct cloud_data_ui *new_ui_data,
-				   int *head_ui_buf)
+/* Check that the message can still be closed within the output buffer. */
+static bool writer_fits(const struct codec_writer *writer)
 {
-
-	if (!new_ui_data->queued) {
-		return;
-	}
-
-	/* Go to start of buffer if end is reached. */
-	*head_ui_buf += 1;
-	if (*head_ui_buf == CONFIG_UI_BUFFER_MAX) {
-		*head_ui_buf = 0;
-	}
-
-	ui_buffer[*head_ui_buf] = *new_ui_data;
-
-	LOG_DBG("Entry: %d of %d in UI buffer filled", *head_ui_buf,
-		CONFIG_UI_BUFFER_MAX - 1);
+	return !writer->err &&
+	       (writer->size - writer->len >= codec_writer_close_len(writer));
 }
 
-void cloud_codec_populate_accel_buffer(
-				struct cloud_data_accelerometer *accel_buf,
-				struct cloud_data_accelerometer *new_accel_data,
-				int *head_accel_buf)
+/* Add the entries of one type oldest first until the next entry does not
+ * fit. The remaining entries of the type are left for the next message.
+ * Entries are only dropped from the ring once the whole message has been
+ * encoded.
+ */
+static void batch_type_add(struct codec_writer *writer,
+			   struct batch_type *type, int64_t ts_offset,
+			   bool *truncated)
 {
-	double buf_lowest_val = 0;
-	double buf_highest_val = 0;
-	double new_entry_highest_val = 0;
-	int64_t newest_time = 0;
+	const struct data_schema *schema = type->schema;
+	struct codec_writer type_start = *writer;
+	struct codec_writer entry_start;
+	const void *prev = NULL;
+	const void *entry;
+	size_t count = type->ring ? data_ring_count(type->ring) : 0;
 
-	if (!new_accel_data->queued) {
+	type->encoded = 0;
+
+	if (count == 0) {
 		return;
 	}
 
-	/** Populate the next available unqueued entry. */
-	for (int k = 0; k < CONFIG_ACCEL_BUFFER_MAX; k++) {
-		if (!accel_buf[k].queued) {
-			*head_accel_buf = k;
-			goto populate_buffer;
-		}
-	}
+	codec_writer_arr_start(writer, schema->batch_key);
 
-	/* Set the initial value of buf_lowest_val to the highest in the
-	 * first accelerometer buffer entry.
-	 */
-	for (int j = 0; j < CONFIG_ACCEL_BUFFER_MAX; j++) {
-		for (int m = 0; m < ACCELEROMETER_TOTAL_AXIS; m++) {
-			if (buf_lowest_val < fabs(accel_buf[j].values[m])) {
-				buf_lowest_val = fabs(accel_buf[j].values[m]);
-			}
-		}
-	}
+	for (size_t i = 0; i < count; i++) {
+		entry_start = *writer;
+		entry = data_ring_get(type->ring, i);
 
-	/* Find the lowest of the highest values in the current accelerometer
-	 * buffer.
-	 */
-	for (int j = 0; j < CONFIG_ACCEL_BUFFER_MAX; j++) {
-		for (int m = 0; m < ACCELEROMETER_TOTAL_AXIS; m++) {
-			if (buf_highest_val < fabs(accel_buf[j].values[m])) {
-				buf_highest_val = fabs(accel_buf[j].values[m]);
-			}
+		if (schema->batch_add) {
+			schema->batch_add(writer, entry, prev, ts_offset);
+		} else {
+			entry_add(writer, schema, entry, true, ts_offset);
 		}
 
-		if (buf_highest_val < buf_lowest_val) {
-			buf_lowest_val = buf_highest_val;
-			*head_accel_buf = j;
+		if (!writer_fits(writer)) {
+			*writer = entry_start;
+			*truncated = true;
+			break;
 		}
 
-		buf_highest_val = 0;
+		prev = entry;
+		type->encoded++;
 	}
 
-	/* Find the highest value in the new accelerometer buffer entry. */
-	for (int n = 0; n < ACCELEROMETER_TOTAL_AXIS; n++) {
-		if (new_entry_highest_val < fabs(new_accel_data->values[n])) {
-			new_entry_highest_val = fabs(new_accel_data->values[n]);
-		}
-	}
-
-	/* If the lowest of the highest accelerometer values in the current
-	 * buffer is higher than the new acceleromter data entry, do nothing.
-	 * If infact a value in the new accelerometer reading is higher,
-	 * replace it with the lowest of the highest values in the current
-	 * acceleromter buffer.
-	 */
-	if (buf_lowest_val > new_entry_highest_val) {
-		goto find_newest_entry;
+	if (type->encoded == 0) {
+		/* Do not leave an empty array behind. */
+		*writer = type_start;
+		return;
 	}
 
-populate_buffer:
+	codec_writer_arr_end(writer);
+}
 
-	accel_buf[*head_accel_buf] = *new_accel_data;
+/* Greedily pack queued entries of the given types into one message of at
+ * most CONFIG_ENCODED_BATCH_LEN_MAX bytes. A type whose next entry does
+ * not fit does not stop the packing, entries of the following types may
+ * still be small enough to fill up the message.
+ */
+static int batch_encode(struct cloud_codec_data *output,
+			struct batch_type *types, size_t type_count)
+{
+	int err;
+	bool truncated = false;
+	size_t encoded = 0;
+	uint32_t start = stats_start();
+	int64_t ts_offset;
+	struct codec_writer writer;
 
-	LOG_DBG("Entry: %d of %d in accelerometer buffer filled",
-		*head_accel_buf, CONFIG_ACCEL_BUFFER_MAX - 1);
+	output->len = 0;
+	output->entries = 0;
 
-find_newest_entry:
-	/* Always point head of buffer to the newest sampled value. */
-	for (int i = 0; i < CONFIG_ACCEL_BUFFER_MAX; i++) {
-		if (newest_time < accel_buf[i].ts && accel_buf[i].queued) {
-			newest_time = accel_buf[i].ts;
-			*head_accel_buf = i;
-		}
+	/* Entries stay queued until the UNIX time is known. Their uptime
+	 * timestamps are converted once it is.
+	 */
+	err = ts_offset_get(&ts_offset);
+	if (err) {
+		return err;
 	}
-}
 
-void cloud_codec_populate_bat_buffer(struct cloud_data_battery *bat_buffer,
-				     struct cloud_data_battery *new_bat_data,
-				     int *head_bat_buf)
-{
-	if (!new_bat_data->queued) {
-		return;
-	}
+	codec_writer_init(&writer, output->buf,
+			  MIN(output->size, CONFIG_ENCODED_BATCH_LEN_MAX));
+	codec_writer_obj_start(&writer, NULL);
 
-	/* Go to start of buffer if end is reached. */
-	*head_bat_buf += 1;
-	if (*head_bat_buf == CONFIG_BAT_BUFFER_MAX) {
-		*head_bat_buf = 0;
+	for (size_t i = 0; i < type_count; i++) {
+		batch_type_add(&writer, &types[i], ts_offset, &truncated);
+		encoded += types[i].encoded;
 	}
 
-	bat_buffer[*head_bat_buf] = *new_bat_data;
+	codec_writer_obj_end(&writer);
 
-	LOG_DBG("Entry: %d of %d in battery buffer filled", *head_bat_buf,
-		CONFIG_BAT_BUFFER_MAX - 1);
-}
+	if (encoded == 0) {
+		if (truncated) {
+			LOG_ERR("Buffered entry does not fit output buffer");
+			return -ENOMEM;
+		}
 
-void cloud_codec_populate_gps_buffer(struct cloud_data_gps *gps_buffer,
-				    struct cloud_data_gps *new_gps_data,
-				    int *head_gps_buf)
-{
-	if (!new_gps_data->queued) {
-		return;
+		return -ENODATA;
 	}
 
-	/* Go to start of buffer if end is reached. */
-	*head_gps_buf += 1;
-	if (*head_gps_buf == CONFIG_GPS_BUFFER_MAX) {
-		*head_gps_buf = 0;
+	err = codec_output_set(output, &writer, "Encoded batch message");
+	if (err) {
+		return err;
 	}
 
-	gps_buffer[*head_gps_buf] = *new_gps_data;
+	for (size_t i = 0; i < type_count; i++) {
+		if (types[i].encoded > 0) {
+			data_ring_pop(types[i].ring, types[i].encoded);
+		}
+	}
 
-	LOG_DBG("Entry: %d of %d in GPS buffer filled", *head_gps_buf,
-		CONFIG_GPS_BUFFER_MAX - 1);
-}
+	output->entries = encoded;
 
-void cloud_codec_populate_modem_buffer(struct cloud_data_modem *modem_buffer,
-				      struct cloud_data_modem *new_modem_data,
-				      int *head_modem_buf)
-{
-	if (!new_modem_data->queued) {
-		return;
-	}
+	LOG_DBG("Batch message: %zu entries, %zu bytes%s", output->entries,
+		output->len, truncated ? ", more entries queued" : "");
 
-	/* Go to start of buffer if end is reached. */
-	*head_modem_buf += 1;
-	if (*head_modem_buf == CONFIG_MODEM_BUFFER_MAX) {
-		*head_modem_buf = 0;
-	}
+	stats_log("batch", start, output->entries, output->len);
 
-	modem_buffer[*head_modem_buf] = *new_modem_data;
+	return 0;
+}
 
-	LOG_DBG("Entry: %d of %d in modem buffer filled", *head_modem_buf,
-		CONFIG_MODEM_BUFFER_MAX - 1);
+int cloud_codec_encode_batch(struct cloud_codec_data *output,
+			     struct data_ring *gps_ring,
+			     struct data_ring *sensor_ring,
+			     struct data_ring *modem_ring,
+			     struct data_ring *ui_ring,
+			     struct data_ring *accel_ring,
+			     struct data_ring *bat_ring)
+{
+	struct batch_type types[] = {
+		BATCH_TYPE(gps_schema, gps_ring),
+		BATCH_TYPE(sensor_schema, sensor_ring),
+		BATCH_TYPE(modem_schema, modem_ring),
+		BATCH_TYPE(ui_schema, ui_ring),
+		BATCH_TYPE(accel_schema, accel_ring),
+		BATCH_TYPE(bat_schema, bat_ring),
+	};
+
+	return batch_encode(output, types, ARRAY_SIZE(types));
 }
@@ -18,6 +18,8 @@
 #include <modem/modem_info.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <data_ring.h>
 
 /**@file
  *
@@ -30,34 +32,83 @@
 extern "C" {
 #endif
 
+/* Buffered entries are kept compact so that the rings hold as many of them as
+ * possible. Measured values are stored as fixed-point integers with the number
+ * of decimals they are published with, timestamps as the uptime in
+ * milliseconds truncated to 32 bits. The cloud codec converts them when the
+ * entries are encoded.
+ */
+
+/** Number of decimals of coordinates, micro-degrees. */
+#define CLOUD_DATA_COORD_DECIMALS 6
+/** Number of decimals of GPS accuracy, altitude, speed and heading. */
+#define CLOUD_DATA_GPS_DECIMALS 1
+/** Number of decimals of temperature and humidity. */
+#define CLOUD_DATA_ENV_DECIMALS 1
+/** Number of decimals of accelerometer values. */
+#define CLOUD_DATA_ACCEL_DECIMALS 2
+
+/**
+ * @brief Convert a value to fixed point.
+ *
+ * @param[in] value Value to convert.
+ * @param[in] decimals Number of decimals of the fixed-point value.
+ * @param[in] min Smallest value of the fixed-point type.
+ * @param[in] max Largest value of the fixed-point type.
+ *
+ * @return Value rounded to the number of decimals, scaled to an integer and
+ *	   limited to [min, max].
+ */
+static inline int32_t cloud_data_fixed(double value, uint8_t decimals,
+				       int32_t min, int32_t max)
+{
+	double fixed = round(value * pow(10.0, decimals));
+
+	return (int32_t)MIN(MAX(fixed, (double)min), (double)max);
+}
+
+/** @brief Get the timestamp of an entry sampled at @p uptime. */
+static inline uint32_t cloud_data_ts(int64_t uptime)
+{
+	return (uint32_t)uptime;
+}
+
+/**
+ * @brief Get the uptime that an entry was sampled at. The timestamp is
+ *	  restored relative to the current uptime, which holds for entries
+ *	  sampled less than 49 days ago.
+ */
+static inline int64_t cloud_data_ts_uptime(uint32_t ts)
+{
+	int64_t now = k_uptime_get();
+
+	return now - (uint32_t)((uint32_t)now - ts);
+}
+
 /** @brief Structure containing battery data published to cloud. */
 struct cloud_data_battery {
+	/** Battery data timestamp. */
+	uint32_t bat_ts;
 	/** Battery voltage level. */
 	uint16_t bat;
-	/** Battery data timestamp. UNIX milliseconds. */
-	int64_t bat_ts;
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
 };
 
 /** @brief Structure containing GPS data published to cloud. */
 struct cloud_data_gps {
-	/** GPS data timestamp. UNIX milliseconds. */
-	int64_t gps_ts;
-	/** Longitude */
-	double longi;
-	/** Latitude */
-	double lat;
-	/** Altitude above WGS-84 ellipsoid in meters. */
-	float alt;
-	/** Accuracy in (2D 1-sigma) in meters. */
-	float acc;
-	/** Horizontal speed in meters. */
-	float spd;
-	/** Heading of movement in degrees. */
-	float hdg;
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
+	/** GPS data timestamp. */
+	uint32_t gps_ts;
+	/** Longitude in micro-degrees. */
+	int32_t longi;
+	/** Latitude in micro-degrees. */
+	int32_t lat;
+	/** Altitude above WGS-84 ellipsoid in decimeters. */
+	int32_t alt;
+	/** Accuracy in (2D 1-sigma) in decimeters. */
+	uint16_t acc;
+	/** Horizontal speed in decimeters per second. */
+	uint16_t spd;
+	/** Heading of movement in tenths of a degree. */
+	uint16_t hdg;
 };
 
 struct cloud_data_cfg {
@@ -76,139 +127,246 @@ struct cloud_data_cfg {
 };
 
 struct cloud_data_accelerometer {
-	/** Accelerometer readings timestamp. UNIX milliseconds. */
-	int64_t ts;
-	/** Accelerometer readings. */
-	double values[3];
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
+	/** Accelerometer readings timestamp. */
+	uint32_t ts;
+	/** Accelerometer readings in hundredths of m/s^2. */
+	int16_t values[3];
 };
 
 struct cloud_data_sensors {
-	/** Environmental sensors timestamp. UNIX milliseconds. */
-	int64_t env_ts;
-	/** Temperature in celcius */
-	double temp;
-	/** Humidity level in percentage */
-	double hum;
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
+	/** Environmental sensors timestamp. */
+	uint32_t env_ts;
+	/** Temperature in tenths of a degree celcius. */
+	int16_t temp;
+	/** Humidity level in tenths of a percent. */
+	uint16_t hum;
 };
 
-struct cloud_data_modem {
-	/** Dynamic modem data timestamp. UNIX milliseconds. */
-	int64_t mod_ts;
-	/** Static modem data timestamp. UNIX milliseconds. */
-	int64_t mod_ts_static;
-	/** Area code. */
-	uint16_t area;
-	/** Cell id. */
-	uint16_t cell;
+/** @brief Modem and device identity, published when it changes. */
+struct cloud_data_modem_static {
+	/** Static modem data timestamp. */
+	uint32_t ts;
 	/** Band number. */
 	uint16_t bnd;
 	/** Network mode GPS. */
-	uint16_t nw_gps;
+	bool nw_gps;
 	/** Network mode LTE-M. */
-	uint16_t nw_lte_m;
+	bool nw_lte_m;
 	/** Network mode NB-IoT. */
-	uint16_t nw_nb_iot;
-	/** Reference Signal Received Power. */
-	uint16_t rsrp;
-	/** Internet Protocol Address. */
-	char *ip;
-	/* Mobile Country Code*/
-	char *mccmnc;
-	/** Application version and Mobile Network Code. */
-	char *appv;
+	bool nw_nb_iot;
+	/** Application version. */
+	const char *appv;
 	/** Device board version. */
 	const char *brdv;
 	/** Modem firmware. */
-	char *fw;
+	const char *fw;
 	/** Integrated Circuit Card Identifier. */
-	char *iccid;
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
+	const char *iccid;
+};
+
+/** Id of a string that is not set, see @ref cloud_codec_str_intern. */
+#define CLOUD_CODEC_STR_NONE UINT8_MAX
+
+/** @brief Dynamic modem data, sampled into every modem entry. */
+struct cloud_data_modem {
+	/** Dynamic modem data timestamp. */
+	uint32_t mod_ts;
+	/** Area code. */
+	uint16_t area;
+	/** Cell id. */
+	uint16_t cell;
+	/** Reference Signal Received Power. */
+	uint16_t rsrp;
+	/** Id of the interned Internet Protocol Address. */
+	uint8_t ip;
+	/** Id of the interned Mobile Country Code and Mobile Network Code. */
+	uint8_t mccmnc;
 };
 
 struct cloud_data_ui {
+	/** Button data timestamp. */
+	uint32_t btn_ts;
 	/** Button number. */
 	int btn;
-	/** Button data timestamp. UNIX milliseconds. */
-	int64_t btn_ts;
-	/** Flag signifying that the data entry is to be published. */
-	bool queued;
 };
 
 struct cloud_codec_data {
-	/** Encoded output. */
+	/** Encoded output. The buffer is provided by the caller. */
 	char *buf;
+	/** Size of the buffer provided by the caller. */
+	size_t size;
 	/** Length of encoded output. */
 	size_t len;
+	/** Number of buffered entries in the encoded output. */
+	size_t entries;
+};
+
+/** Maximum number of fields of a data type that is delta reported. */
+#define CLOUD_CODEC_REPORT_FIELDS_MAX 8
+/** Number of data types that are delta reported. */
+#define CLOUD_CODEC_REPORT_TYPES 3
+
+/**
+ * @brief Values added to a device shadow report, staged by
+ *	  @ref cloud_codec_encode_data until the report is published. The
+ *	  structure is owned by the caller and opaque to it.
+ */
+struct cloud_codec_report {
+	/** Added values of every delta reported data type. */
+	int32_t values[CLOUD_CODEC_REPORT_TYPES][CLOUD_CODEC_REPORT_FIELDS_MAX];
+	/** Bitmask of the added fields of every data type. */
+	uint8_t fields[CLOUD_CODEC_REPORT_TYPES];
+	/** Static modem data was added. */
+	bool modem_static;
+	/** Hash of the added static modem data. */
+	uint32_t modem_hash;
+	/** Cloud session the report was encoded in. */
+	uint32_t session;
 };
 
-int cloud_codec_decode_response(char *input, struct cloud_data_cfg *cfg);
+int cloud_codec_decode_response(char *input, size_t len,
+				struct cloud_data_cfg *cfg);
 
 int cloud_codec_encode_cfg_data(struct cloud_codec_data *output,
 				struct cloud_data_cfg *cfg_buffer);
 
+/**
+ * @brief Intern a string that buffered entries refer to. Entries hold the
+ *	  returned id instead of a copy of the string. Equal strings share
+ *	  one of CONFIG_CLOUD_CODEC_STR_POOL_SIZE slots, and every returned id
+ *	  is a reference to it that is released with
+ *	  @ref cloud_codec_str_release. A slot is only reused once all
+ *	  references to it are released. Strings are truncated to
+ *	  CONFIG_CLOUD_CODEC_STR_LEN_MAX characters.
+ *
+ * @param[in] str String to intern, NULL for no string.
+ *
+ * @return Id of the string or CLOUD_CODEC_STR_NONE if @p str is NULL or all
+ *	   slots are referenced.
+ */
+uint8_t cloud_codec_str_intern(const char *str);
+
+/**
+ * @brief Take another reference to an interned string, for instance for a
+ *	  copy of an entry.
+ *
+ * @param[in] id Id of the string, CLOUD_CODEC_STR_NONE is ignored.
+ */
+void cloud_codec_str_retain(uint8_t id);
+
+/**
+ * @brief Release a reference to an interned string.
+ *
+ * @param[in] id Id of the string, CLOUD_CODEC_STR_NONE is ignored.
+ */
+void cloud_codec_str_release(uint8_t id);
+
+/**
+ * @brief Encode the latest entry of every data type as a device shadow
+ *	  report. With CONFIG_CLOUD_CODEC_DELTA_REPORTING values that have not
+ *	  changed since they were last reported are left out.
+ *
+ * @param[in,out] output Output buffer provided by the caller.
+ * @param[out] report Values added to the report. They are compared against
+ *		      in later reports only once the report is published and
+ *		      committed with @ref cloud_codec_report_commit.
+ * @param[in] gps_buf Latest GPS entry, NULL if there is none. The same
+ *		      applies to all other entries.
+ * @param[in] modem_static Modem and device identity, NULL if not known yet.
+ *			   It is included in the first report of a cloud
+ *			   session and whenever it has changed.
+ *
+ * @return 0 on success, -ENODATA if there is nothing to report, either
+ *	   because no entry was given or because none of them has changed,
+ *	   -EAGAIN if the UNIX time is not known yet or negative error value
+ *	   on failure. The given entries are reported unless an error other
+ *	   than -ENODATA is returned.
+ */
 int cloud_codec_encode_data(struct cloud_codec_data *output,
+			    struct cloud_codec_report *report,
 			    struct cloud_data_gps *gps_buf,
 			    struct cloud_data_sensors *sensor_buf,
 			    struct cloud_data_modem *modem_buf,
+			    struct cloud_data_modem_static *modem_static,
 			    struct cloud_data_ui *ui_buf,
 			    struct cloud_data_accelerometer *accel_buf,
 			    struct cloud_data_battery *bat_buf);
 
+/**
+ * @brief Encode queued entries of all rings into a single batch message.
+ *
+ * Entries are packed by their encoded size, GPS first and battery last,
+ * until the output buffer or CONFIG_ENCODED_BATCH_LEN_MAX is exhausted. If
+ * the next entry of one type does not fit, smaller entries of the following
+ * types are still added. Entries are taken oldest first and only the ones
+ * that made it into the message are dropped from their ring, so the function
+ * can be called repeatedly until it returns -ENODATA. The number of encoded
+ * entries is reported in @p output->entries.
+ *
+ * @param[in,out] output Output buffer provided by the caller.
+ * @param[in,out] gps_ring GPS entries, NULL to leave out GPS data. The same
+ *			   applies to all other rings.
+ *
+ * Entry timestamps are uptime based and converted to UNIX time with an
+ * offset resolved once per message. Until the UNIX time is known all
+ * entries stay queued.
+ *
+ * @return 0 on success, -ENODATA if no entries are queued, -EAGAIN if the
+ *	   UNIX time is not known yet, -ENOMEM if a single entry does not fit
+ *	   the output buffer or another negative error value on failure.
+ */
+int cloud_codec_encode_batch(struct cloud_codec_data *output,
+			     struct data_ring *gps_ring,
+			     struct data_ring *sensor_ring,
+			     struct data_ring *modem_ring,
+			     struct data_ring *ui_ring,
+			     struct data_ring *accel_ring,
+			     struct data_ring *bat_ring);
+
+/**
+ * @brief Encode a button press.
+ *
+ * @return 0 on success, -ENODATA if @p ui_buf is NULL, -EAGAIN if the UNIX
+ *	   time is not known yet or negative error value on failure.
+ */
 int cloud_codec_encode_ui_data(struct cloud_codec_data *output,
 			       struct cloud_data_ui *ui_buf);
 
-int cloud_codec_encode_gps_buffer(struct cloud_codec_data *output,
-				  struct cloud_data_gps *data);
-
-int cloud_codec_encode_modem_buffer(struct cloud_codec_data *output,
-				    struct cloud_data_modem *data);
-
-int cloud_codec_encode_sensor_buffer(struct cloud_codec_data *output,
-				     struct cloud_data_sensors *data);
-
-int cloud_codec_encode_ui_buffer(struct cloud_codec_data *output,
-				 struct cloud_data_ui *data);
-
-int cloud_codec_encode_accel_buffer(struct cloud_codec_data *output,
-				    struct cloud_data_accelerometer *data);
-
-int cloud_codec_encode_bat_buffer(struct cloud_codec_data *output,
-				  struct cloud_data_battery *data);
-
-void cloud_codec_populate_sensor_buffer(
-				struct cloud_data_sensors *sensor_buffer,
-				struct cloud_data_sensors *new_sensor_data,
-				int *head_sensor_buf);
-
-void cloud_codec_populate_ui_buffer(struct cloud_data_ui *ui_buffer,
-				    struct cloud_data_ui *new_ui_data,
-				    int *head_ui_buf);
-
-void cloud_codec_populate_accel_buffer(
-				struct cloud_data_accelerometer *accel_buf,
-				struct cloud_data_accelerometer *new_accel_data,
-				int *head_accel_buf);
-
-void cloud_codec_populate_bat_buffer(struct cloud_data_battery *bat_buffer,
-				     struct cloud_data_battery *new_bat_data,
-				     int *head_bat_buf);
+/**
+ * @brief Start a new cloud session. Static modem data and all delta reported
+ *	  values are included again in the next message encoded by
+ *	  @ref cloud_codec_encode_data.
+ */
+void cloud_codec_session_reset(void);
 
-void cloud_codec_populate_gps_buffer(struct cloud_data_gps *gps_buffer,
-				     struct cloud_data_gps *new_gps_data,
-				     int *head_gps_buf);
+/**
+ * @brief Commit a published device shadow report. The values it added are
+ *	  the last reported ones from now on, and static modem data is not
+ *	  included again until it changes. Until then every report includes
+ *	  them again.
+ *
+ * @param[in] report Report staged by @ref cloud_codec_encode_data. It is
+ *		     ignored if the cloud session was reset since.
+ */
+void cloud_codec_report_commit(const struct cloud_codec_report *report);
 
-void cloud_codec_populate_modem_buffer(struct cloud_data_modem *modem_buffer,
-				       struct cloud_data_modem *new_modem_data,
-				       int *head_modem_buf);
+/**
+ * @brief Get the length of the largest message encoded since boot.
+ *
+ * The codec does not allocate memory, all messages are encoded into the
+ * buffer provided by the caller. The high-water mark is meant for sizing
+ * that buffer and CONFIG_ENCODED_BATCH_LEN_MAX.
+ *
+ * @return Length of the largest encoded message in bytes.
+ */
+size_t cloud_codec_output_len_max_get(void);
 
+/** @brief Release encoded data. The output buffer is owned by the caller
+ *	   and is not freed, only the encoded length is reset.
+ */
 static inline void cloud_codec_release_data(struct cloud_codec_data *output)
 {
-	free(output->buf);
+	output->len = 0;
 }
 
 #ifdef __cplusplus
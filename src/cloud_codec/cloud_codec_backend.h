@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Cloud codec serialization backend interface.
+ */
+
+#ifndef CLOUD_CODEC_BACKEND_H__
+#define CLOUD_CODEC_BACKEND_H__
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <cloud_codec.h>
+
+/**@file
+ *
+ * @defgroup cloud_codec_backend Cloud codec backend
+ * @brief    Interface between the cloud codec and its serialization backends.
+ *
+ * The cloud codec describes every message as a tree of objects, arrays and
+ * values through the writer functions below. Exactly one backend is built,
+ * selected by CONFIG_SERIALIZATION_JSON or CONFIG_SERIALIZATION_CBOR, and it
+ * streams the tree straight into a caller-supplied buffer without allocating
+ * memory.
+ *
+ * Errors are sticky. Once the buffer is exhausted all further calls are
+ * ignored and the error is returned by @ref codec_writer_finish.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum nesting depth of objects and arrays. */
+#define CODEC_WRITER_DEPTH_MAX 32
+
+struct codec_writer {
+	/** Output buffer. */
+	uint8_t *buf;
+	/** Size of output buffer. */
+	size_t size;
+	/** Number of bytes written. */
+	size_t len;
+	/** Bitmask of nesting levels that already hold a member. */
+	uint32_t members;
+	/** Current nesting level. */
+	uint8_t depth;
+	/** First error encountered, 0 if none. */
+	int err;
+};
+
+/**
+ * @brief Initialize a writer.
+ *
+ * @param[out] w Pointer to writer.
+ * @param[in] buf Buffer that the output is written to.
+ * @param[in] size Size of the buffer.
+ */
+void codec_writer_init(struct codec_writer *w, void *buf, size_t size);
+
+/**
+ * @brief Open an object. If @p key is NULL the object is written as an array
+ *	  element or as the root value.
+ */
+void codec_writer_obj_start(struct codec_writer *w, const char *key);
+
+/** @brief Close the innermost object. */
+void codec_writer_obj_end(struct codec_writer *w);
+
+/**
+ * @brief Open an array. If @p key is NULL the array is written as an array
+ *	  element or as the root value.
+ */
+void codec_writer_arr_start(struct codec_writer *w, const char *key);
+
+/** @brief Close the innermost array. */
+void codec_writer_arr_end(struct codec_writer *w);
+
+/**
+ * @brief Write a number. Integral values are written as integers, other
+ *	  values with the shortest representation that reads back to the
+ *	  same double.
+ */
+void codec_writer_number(struct codec_writer *w, const char *key,
+			 double value);
+
+/**
+ * @brief Write a number rounded to a fixed number of decimals. Trailing
+ *	  zeros are not written and values that round to an integer are
+ *	  written as integers. The CBOR backend uses single precision if it
+ *	  holds the rounded value within the requested number of decimals.
+ */
+void codec_writer_number_prec(struct codec_writer *w, const char *key,
+			      double value, uint8_t decimals);
+
+/** @brief Write a boolean. */
+void codec_writer_bool(struct codec_writer *w, const char *key, bool value);
+
+/** @brief Write a string. NULL is written as a null value. */
+void codec_writer_str(struct codec_writer *w, const char *key,
+		      const char *value);
+
+/**
+ * @brief Write a value that was encoded earlier by the same backend, for
+ *	  instance the output of a separate writer. The value is copied as is.
+ *
+ * @param[in] w Pointer to writer.
+ * @param[in] key Key of the value, NULL for an array element.
+ * @param[in] data Encoded value.
+ * @param[in] len Length of the encoded value.
+ */
+void codec_writer_encoded(struct codec_writer *w, const char *key,
+			  const void *data, size_t len);
+
+/**
+ * @brief Get the number of bytes needed to close all open objects and arrays
+ *	  and finish the output.
+ */
+size_t codec_writer_close_len(const struct codec_writer *w);
+
+/**
+ * @brief Finish the output. The JSON backend terminates the output with a
+ *	  NULL character that is not included in the length.
+ *
+ * @param[in] w Pointer to writer.
+ *
+ * @return 0 on success, -ENOMEM if the output did not fit the buffer or
+ *	   -EINVAL if objects and arrays were not properly nested.
+ */
+int codec_writer_finish(struct codec_writer *w);
+
+/**
+ * @brief Decode a device configuration message. The configuration is either
+ *	  found in a top level "cfg" object or in "state"."cfg". Every
+ *	  member of it is passed to @ref codec_cfg_value_set.
+ *
+ * @param[in] input Encoded message.
+ * @param[in] len Length of the encoded message.
+ * @param[out] cfg Configuration to update.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
+int codec_backend_cfg_decode(const char *input, size_t len,
+			     struct cloud_data_cfg *cfg);
+
+/**
+ * @brief Apply a decoded configuration value. Implemented by the cloud codec
+ *	  and shared by all backends. Unknown keys are ignored.
+ *
+ * @param[out] cfg Configuration to update.
+ * @param[in] key Configuration key, not necessarily NULL terminated.
+ * @param[in] key_len Length of the key.
+ * @param[in] value Decoded value. Booleans are passed as 0 or 1.
+ */
+void codec_cfg_value_set(struct cloud_data_cfg *cfg, const char *key,
+			 size_t key_len, int value);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,715 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "cloud_codec_backend.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_cbor, CONFIG_CAT_TRACKER_LOG_LEVEL);
+
+/* CBOR (RFC 7049) major types. */
+#define CBOR_MAJOR_UINT 0
+#define CBOR_MAJOR_NINT 1
+#define CBOR_MAJOR_BSTR 2
+#define CBOR_MAJOR_TSTR 3
+#define CBOR_MAJOR_ARRAY 4
+#define CBOR_MAJOR_MAP 5
+#define CBOR_MAJOR_TAG 6
+#define CBOR_MAJOR_SIMPLE 7
+
+/* Additional information values. */
+#define CBOR_INFO_UINT8 24
+#define CBOR_INFO_UINT16 25
+#define CBOR_INFO_UINT32 26
+#define CBOR_INFO_UINT64 27
+#define CBOR_INFO_INDEFINITE 31
+
+/* Simple values. */
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+#define CBOR_FLOAT16 CBOR_INFO_UINT16
+#define CBOR_FLOAT32 CBOR_INFO_UINT32
+#define CBOR_FLOAT64 CBOR_INFO_UINT64
+
+#define CBOR_BREAK 0xFF
+
+/* Nesting depth accepted when skipping unknown items in incoming messages. */
+#define CBOR_DECODE_DEPTH_MAX 8
+
+static bool space_check(struct codec_writer *w, size_t len)
+{
+	if (w->err) {
+		return false;
+	}
+
+	if (w->len + len > w->size) {
+		w->err = -ENOMEM;
+		return false;
+	}
+
+	return true;
+}
+
+static void raw_write(struct codec_writer *w, const void *data, size_t len)
+{
+	if (!space_check(w, len)) {
+		return;
+	}
+
+	memcpy(&w->buf[w->len], data, len);
+	w->len += len;
+}
+
+static void byte_write(struct codec_writer *w, uint8_t byte)
+{
+	raw_write(w, &byte, 1);
+}
+
+/* Write the initial byte of a data item followed by its argument in the
+ * shortest form, most significant byte first.
+ */
+static void head_write(struct codec_writer *w, uint8_t major, uint64_t arg)
+{
+	uint8_t head[9];
+	size_t arg_len;
+	uint8_t info;
+
+	if (arg < CBOR_INFO_UINT8) {
+		info = arg;
+		arg_len = 0;
+	} else if (arg <= UINT8_MAX) {
+		info = CBOR_INFO_UINT8;
+		arg_len = 1;
+	} else if (arg <= UINT16_MAX) {
+		info = CBOR_INFO_UINT16;
+		arg_len = 2;
+	} else if (arg <= UINT32_MAX) {
+		info = CBOR_INFO_UINT32;
+		arg_len = 4;
+	} else {
+		info = CBOR_INFO_UINT64;
+		arg_len = 8;
+	}
+
+	head[0] = (major << 5) | info;
+
+	for (size_t i = 0; i < arg_len; i++) {
+		head[arg_len - i] = arg >> (8 * i);
+	}
+
+	raw_write(w, head, arg_len + 1);
+}
+
+static void text_write(struct codec_writer *w, const char *str)
+{
+	size_t len = strlen(str);
+
+	head_write(w, CBOR_MAJOR_TSTR, len);
+	raw_write(w, str, len);
+}
+
+static void key_write(struct codec_writer *w, const char *key)
+{
+	if (key != NULL) {
+		text_write(w, key);
+	}
+}
+
+static void level_push(struct codec_writer *w, const char *key, uint8_t major)
+{
+	key_write(w, key);
+	byte_write(w, (major << 5) | CBOR_INFO_INDEFINITE);
+
+	if (w->depth >= CODEC_WRITER_DEPTH_MAX - 1) {
+		w->err = w->err ? w->err : -EINVAL;
+		return;
+	}
+
+	w->depth++;
+}
+
+static void level_pop(struct codec_writer *w)
+{
+	if (w->depth == 0) {
+		w->err = w->err ? w->err : -EINVAL;
+		return;
+	}
+
+	w->depth--;
+	byte_write(w, CBOR_BREAK);
+}
+
+void codec_writer_init(struct codec_writer *w, void *buf, size_t size)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->members = 0;
+	w->depth = 0;
+	w->err = (buf == NULL || size == 0) ? -EINVAL : 0;
+}
+
+void codec_writer_obj_start(struct codec_writer *w, const char *key)
+{
+	/* Maps and arrays use indefinite length so that the number of
+	 * members does not have to be known up front.
+	 */
+	level_push(w, key, CBOR_MAJOR_MAP);
+}
+
+void codec_writer_obj_end(struct codec_writer *w)
+{
+	level_pop(w);
+}
+
+void codec_writer_arr_start(struct codec_writer *w, const char *key)
+{
+	level_push(w, key, CBOR_MAJOR_ARRAY);
+}
+
+void codec_writer_arr_end(struct codec_writer *w)
+{
+	level_pop(w);
+}
+
+static void float32_write(struct codec_writer *w, float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | CBOR_FLOAT32);
+	for (int i = 3; i >= 0; i--) {
+		byte_write(w, bits >> (8 * i));
+	}
+}
+
+static void float64_write(struct codec_writer *w, double value)
+{
+	uint64_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | CBOR_FLOAT64);
+	for (int i = 7; i >= 0; i--) {
+		byte_write(w, bits >> (8 * i));
+	}
+}
+
+/* Write an integer if the value is integral. */
+static bool integer_write(struct codec_writer *w, double value)
+{
+	int64_t integer;
+
+	if (!(fabs(value) < 9.2e18) || (value != floor(value))) {
+		return false;
+	}
+
+	integer = value;
+
+	if (integer >= 0) {
+		head_write(w, CBOR_MAJOR_UINT, integer);
+	} else {
+		head_write(w, CBOR_MAJOR_NINT, -1 - integer);
+	}
+
+	return true;
+}
+
+void codec_writer_number(struct codec_writer *w, const char *key,
+			 double value)
+{
+	key_write(w, key);
+
+	if (isnan(value) || isinf(value)) {
+		byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | CBOR_NULL);
+	} else if (integer_write(w, value)) {
+		return;
+	} else if ((double)(float)value == value) {
+		/* Single precision is enough for values that were sampled as
+		 * floats, which covers most of the sensor data.
+		 */
+		float32_write(w, value);
+	} else {
+		float64_write(w, value);
+	}
+}
+
+void codec_writer_number_prec(struct codec_writer *w, const char *key,
+			      double value, uint8_t decimals)
+{
+	double scale = pow(10, decimals);
+	double rounded = round(value * scale) / scale;
+
+	key_write(w, key);
+
+	if (isnan(value) || isinf(value)) {
+		byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | CBOR_NULL);
+	} else if (integer_write(w, rounded)) {
+		return;
+	} else if (fabs((double)(float)rounded - rounded) * scale < 0.5) {
+		/* Single precision holds the value within the requested
+		 * number of decimals.
+		 */
+		float32_write(w, rounded);
+	} else {
+		float64_write(w, rounded);
+	}
+}
+
+void codec_writer_bool(struct codec_writer *w, const char *key, bool value)
+{
+	uint8_t simple = value ? CBOR_TRUE : CBOR_FALSE;
+
+	key_write(w, key);
+	byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | simple);
+}
+
+void codec_writer_str(struct codec_writer *w, const char *key,
+		      const char *value)
+{
+	key_write(w, key);
+
+	if (value == NULL) {
+		byte_write(w, (CBOR_MAJOR_SIMPLE << 5) | CBOR_NULL);
+		return;
+	}
+
+	text_write(w, value);
+}
+
+void codec_writer_encoded(struct codec_writer *w, const char *key,
+			  const void *data, size_t len)
+{
+	key_write(w, key);
+	raw_write(w, data, len);
+}
+
+size_t codec_writer_close_len(const struct codec_writer *w)
+{
+	/* One break code per level. */
+	return w->depth;
+}
+
+int codec_writer_finish(struct codec_writer *w)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	if (w->depth != 0) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+struct cbor_reader {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+};
+
+struct cbor_head {
+	uint8_t major;
+	uint8_t info;
+	uint64_t arg;
+};
+
+static int head_read(struct cbor_reader *r, struct cbor_head *head)
+{
+	size_t arg_len;
+
+	if (r->pos >= r->len) {
+		return -EBADMSG;
+	}
+
+	head->major = r->buf[r->pos] >> 5;
+	head->info = r->buf[r->pos] & 0x1F;
+	head->arg = 0;
+	r->pos++;
+
+	if (head->info < CBOR_INFO_UINT8) {
+		head->arg = head->info;
+		return 0;
+	}
+
+	if (head->info == CBOR_INFO_INDEFINITE) {
+		return 0;
+	}
+
+	if (head->info > CBOR_INFO_UINT64) {
+		return -EBADMSG;
+	}
+
+	arg_len = 1 << (head->info - CBOR_INFO_UINT8);
+	if (r->len - r->pos < arg_len) {
+		return -EBADMSG;
+	}
+
+	for (size_t i = 0; i < arg_len; i++) {
+		head->arg = (head->arg << 8) | r->buf[r->pos++];
+	}
+
+	return 0;
+}
+
+/* Consume a break code if it is the next byte. */
+static bool break_read(struct cbor_reader *r)
+{
+	if (r->pos < r->len && r->buf[r->pos] == CBOR_BREAK) {
+		r->pos++;
+		return true;
+	}
+
+	return false;
+}
+
+static int item_skip(struct cbor_reader *r, int depth)
+{
+	int err;
+	uint64_t count;
+	struct cbor_head head;
+
+	if (depth > CBOR_DECODE_DEPTH_MAX) {
+		return -EBADMSG;
+	}
+
+	err = head_read(r, &head);
+	if (err) {
+		return err;
+	}
+
+	switch (head.major) {
+	case CBOR_MAJOR_UINT:
+	case CBOR_MAJOR_NINT:
+		return 0;
+	case CBOR_MAJOR_BSTR:
+	case CBOR_MAJOR_TSTR:
+		if (head.info == CBOR_INFO_INDEFINITE) {
+			/* Chunked string, the chunks are definite strings. */
+			while (!break_read(r)) {
+				err = item_skip(r, depth + 1);
+				if (err) {
+					return err;
+				}
+			}
+
+			return 0;
+		}
+
+		if (head.arg > r->len - r->pos) {
+			return -EBADMSG;
+		}
+
+		r->pos += head.arg;
+		return 0;
+	case CBOR_MAJOR_ARRAY:
+	case CBOR_MAJOR_MAP:
+		if (head.info == CBOR_INFO_INDEFINITE) {
+			while (!break_read(r)) {
+				err = item_skip(r, depth + 1);
+				if (err) {
+					return err;
+				}
+			}
+
+			return 0;
+		}
+
+		count = head.major == CBOR_MAJOR_MAP ? 2 * head.arg : head.arg;
+
+		for (uint64_t i = 0; i < count; i++) {
+			err = item_skip(r, depth + 1);
+			if (err) {
+				return err;
+			}
+		}
+
+		return 0;
+	case CBOR_MAJOR_TAG:
+		return item_skip(r, depth + 1);
+	default:
+		/* Simple values and floats are fully consumed by head_read(),
+		 * a break code is not expected here.
+		 */
+		return head.info == CBOR_INFO_INDEFINITE ? -EBADMSG : 0;
+	}
+}
+
+/* Iterate the members of the map at the reader position. The caller must
+ * consume exactly one key and one value for every call that returns true.
+ */
+struct cbor_map_iter {
+	uint64_t remaining;
+	bool indefinite;
+};
+
+static int map_enter(struct cbor_reader *r, struct cbor_map_iter *iter)
+{
+	int err;
+	struct cbor_head head;
+
+	err = head_read(r, &head);
+	if (err) {
+		return err;
+	}
+
+	if (head.major != CBOR_MAJOR_MAP) {
+		return -EBADMSG;
+	}
+
+	iter->indefinite = head.info == CBOR_INFO_INDEFINITE;
+	iter->remaining = head.arg;
+
+	return 0;
+}
+
+/* Returns a positive value if another member follows, 0 at the end of the
+ * map and -EBADMSG if the message ends before the map does.
+ */
+static int map_next(struct cbor_reader *r, struct cbor_map_iter *iter)
+{
+	if (iter->indefinite) {
+		if (r->pos >= r->len) {
+			return -EBADMSG;
+		}
+
+		return break_read(r) ? 0 : 1;
+	}
+
+	if (iter->remaining == 0) {
+		return 0;
+	}
+
+	iter->remaining--;
+	return 1;
+}
+
+/* Read a text string key. Keys of other types are skipped and reported with
+ * a NULL key.
+ */
+static int key_read(struct cbor_reader *r, const char **key, size_t *key_len)
+{
+	int err;
+	size_t start = r->pos;
+	struct cbor_head head;
+
+	err = head_read(r, &head);
+	if (err) {
+		return err;
+	}
+
+	if (head.major != CBOR_MAJOR_TSTR ||
+	    head.info == CBOR_INFO_INDEFINITE) {
+		*key = NULL;
+		r->pos = start;
+		return item_skip(r, 0);
+	}
+
+	if (head.arg > r->len - r->pos) {
+		return -EBADMSG;
+	}
+
+	*key = (const char *)&r->buf[r->pos];
+	*key_len = head.arg;
+	r->pos += head.arg;
+
+	return 0;
+}
+
+/* Position the reader at the value that belongs to @p key in the map at the
+ * reader position.
+ */
+static int map_find(struct cbor_reader *r, const char *key)
+{
+	int err;
+	const char *member;
+	size_t member_len;
+	struct cbor_map_iter iter;
+
+	err = map_enter(r, &iter);
+	if (err) {
+		return err;
+	}
+
+	while ((err = map_next(r, &iter)) > 0) {
+		err = key_read(r, &member, &member_len);
+		if (err) {
+			return err;
+		}
+
+		if (member != NULL && member_len == strlen(key) &&
+		    memcmp(member, key, member_len) == 0) {
+			return 0;
+		}
+
+		err = item_skip(r, 0);
+		if (err) {
+			return err;
+		}
+	}
+
+	return err ? err : -ENOENT;
+}
+
+/* Half precision float as in appendix D of RFC 7049. */
+static double half_to_double(uint16_t half)
+{
+	int exp = (half >> 10) & 0x1F;
+	int mant = half & 0x3FF;
+	double value;
+
+	if (exp == 0) {
+		value = ldexp(mant, -24);
+	} else if (exp != 31) {
+		value = ldexp(mant + 1024, exp - 25);
+	} else {
+		value = (mant == 0) ? INFINITY : NAN;
+	}
+
+	return (half & 0x8000) ? -value : value;
+}
+
+/* Convert a float to int like the JSON backend does, limited to the range of
+ * int. NaN has no integer value and is skipped like values of other types.
+ */
+static int float_to_int(double number, int *value)
+{
+	if (isnan(number)) {
+		return -ENOTSUP;
+	}
+
+	if (number >= INT_MAX) {
+		*value = INT_MAX;
+	} else if (number <= (double)INT_MIN) {
+		*value = INT_MIN;
+	} else {
+		*value = (int)number;
+	}
+
+	return 0;
+}
+
+/* Read an integer, boolean or float value. Values out of the range of int
+ * are limited to it. Other values are skipped and -ENOTSUP is returned.
+ */
+static int int_read(struct cbor_reader *r, int *value)
+{
+	int err;
+	size_t start = r->pos;
+	struct cbor_head head;
+
+	err = head_read(r, &head);
+	if (err) {
+		return err;
+	}
+
+	switch (head.major) {
+	case CBOR_MAJOR_UINT:
+		*value = (head.arg > INT_MAX) ? INT_MAX : (int)head.arg;
+		return 0;
+	case CBOR_MAJOR_NINT:
+		/* The value is -1 - arg. */
+		*value = (head.arg > INT_MAX) ? INT_MIN : -1 - (int)head.arg;
+		return 0;
+	case CBOR_MAJOR_SIMPLE:
+		if (head.info == CBOR_FALSE || head.info == CBOR_TRUE) {
+			*value = head.info == CBOR_TRUE;
+			return 0;
+		} else if (head.info == CBOR_FLOAT16) {
+			return float_to_int(half_to_double(head.arg), value);
+		} else if (head.info == CBOR_FLOAT32) {
+			uint32_t bits = head.arg;
+			float single;
+
+			memcpy(&single, &bits, sizeof(single));
+			return float_to_int(single, value);
+		} else if (head.info == CBOR_FLOAT64) {
+			double number;
+
+			memcpy(&number, &head.arg, sizeof(number));
+			return float_to_int(number, value);
+		}
+		break;
+	default:
+		break;
+	}
+
+	r->pos = start;
+
+	err = item_skip(r, 0);
+	if (err) {
+		return err;
+	}
+
+	return -ENOTSUP;
+}
+
+int codec_backend_cfg_decode(const char *input, size_t len,
+			     struct cloud_data_cfg *cfg)
+{
+	int err;
+	int value;
+	const char *key;
+	size_t key_len;
+	struct cbor_map_iter iter;
+	struct cbor_reader reader = { .buf = (const uint8_t *)input,
+				      .len = len };
+
+	LOG_HEXDUMP_DBG(input, len, "Decoded message");
+
+	err = map_find(&reader, "cfg");
+	if (err == -ENOENT) {
+		reader.pos = 0;
+
+		err = map_find(&reader, "state");
+		if (err) {
+			return err == -ENOENT ? 0 : err;
+		}
+
+		err = map_find(&reader, "cfg");
+	}
+
+	if (err) {
+		return err == -ENOENT ? 0 : err;
+	}
+
+	err = map_enter(&reader, &iter);
+	if (err) {
+		return err;
+	}
+
+	while ((err = map_next(&reader, &iter)) > 0) {
+		err = key_read(&reader, &key, &key_len);
+		if (err) {
+			return err;
+		}
+
+		if (key == NULL) {
+			err = item_skip(&reader, 0);
+			if (err) {
+				return err;
+			}
+
+			continue;
+		}
+
+		err = int_read(&reader, &value);
+		if (err == -ENOTSUP) {
+			continue;
+		} else if (err) {
+			return err;
+		}
+
+		codec_cfg_value_set(cfg, key, key_len, value);
+	}
+
+	return err;
+}
@@ -0,0 +1,575 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "cloud_codec_backend.h"
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(cloud_codec_json, CONFIG_CAT_TRACKER_LOG_LEVEL);
+
+static bool space_check(struct codec_writer *w, size_t len)
+{
+	if (w->err) {
+		return false;
+	}
+
+	/* Always keep room for the NULL terminator. */
+	if (w->len + len >= w->size) {
+		w->err = -ENOMEM;
+		return false;
+	}
+
+	return true;
+}
+
+static void raw_write(struct codec_writer *w, const char *data, size_t len)
+{
+	if (!space_check(w, len)) {
+		return;
+	}
+
+	memcpy(&w->buf[w->len], data, len);
+	w->len += len;
+}
+
+static void char_write(struct codec_writer *w, char c)
+{
+	raw_write(w, &c, 1);
+}
+
+static void str_write(struct codec_writer *w, const char *str)
+{
+	const char *start = str;
+
+	char_write(w, '"');
+
+	for (; *str != '\0'; str++) {
+		char escaped[7];
+		unsigned char c = *str;
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+
+		/* Flush the run of characters that need no escaping. */
+		raw_write(w, start, str - start);
+		start = str + 1;
+
+		switch (c) {
+		case '"':
+		case '\\':
+			escaped[0] = '\\';
+			escaped[1] = c;
+			raw_write(w, escaped, 2);
+			break;
+		case '\n':
+			raw_write(w, "\\n", 2);
+			break;
+		case '\r':
+			raw_write(w, "\\r", 2);
+			break;
+		case '\t':
+			raw_write(w, "\\t", 2);
+			break;
+		default:
+			snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+			raw_write(w, escaped, 6);
+			break;
+		}
+	}
+
+	raw_write(w, start, str - start);
+	char_write(w, '"');
+}
+
+/* Write the separator and key that precede a value at the current level. */
+static void member_write(struct codec_writer *w, const char *key)
+{
+	uint32_t level = BIT(w->depth);
+
+	if (w->members & level) {
+		char_write(w, ',');
+	}
+
+	w->members |= level;
+
+	if (key != NULL) {
+		str_write(w, key);
+		char_write(w, ':');
+	}
+}
+
+static void level_push(struct codec_writer *w, const char *key, char open)
+{
+	member_write(w, key);
+	char_write(w, open);
+
+	if (w->depth >= CODEC_WRITER_DEPTH_MAX - 1) {
+		w->err = w->err ? w->err : -EINVAL;
+		return;
+	}
+
+	w->depth++;
+	w->members &= ~BIT(w->depth);
+}
+
+static void level_pop(struct codec_writer *w, char close)
+{
+	if (w->depth == 0) {
+		w->err = w->err ? w->err : -EINVAL;
+		return;
+	}
+
+	w->depth--;
+	char_write(w, close);
+}
+
+void codec_writer_init(struct codec_writer *w, void *buf, size_t size)
+{
+	w->buf = buf;
+	w->size = size;
+	w->len = 0;
+	w->members = 0;
+	w->depth = 0;
+	w->err = (buf == NULL || size == 0) ? -EINVAL : 0;
+}
+
+void codec_writer_obj_start(struct codec_writer *w, const char *key)
+{
+	level_push(w, key, '{');
+}
+
+void codec_writer_obj_end(struct codec_writer *w)
+{
+	level_pop(w, '}');
+}
+
+void codec_writer_arr_start(struct codec_writer *w, const char *key)
+{
+	level_push(w, key, '[');
+}
+
+void codec_writer_arr_end(struct codec_writer *w)
+{
+	level_pop(w, ']');
+}
+
+/* Commit a number printed to the output, or flag the buffer as full. */
+static void number_commit(struct codec_writer *w, int len, size_t available)
+{
+	if (len < 0 || (size_t)len >= available) {
+		w->err = -ENOMEM;
+		return;
+	}
+
+	w->len += (size_t)len;
+}
+
+void codec_writer_number(struct codec_writer *w, const char *key,
+			 double value)
+{
+	char *out;
+	size_t available;
+	int len;
+
+	member_write(w, key);
+
+	if (!space_check(w, 0)) {
+		return;
+	}
+
+	out = (char *)&w->buf[w->len];
+	available = w->size - w->len;
+
+	/* Same representation as cJSON: JSON has no NaN or infinity, integral
+	 * values are printed without decimals and other values use 15
+	 * significant digits unless 17 are needed to read back the same value.
+	 */
+	if (isnan(value) || isinf(value)) {
+		len = snprintf(out, available, "null");
+	} else if (fabs(value) < 1e15 && value == floor(value)) {
+		len = snprintf(out, available, "%lld", (long long)value);
+	} else {
+		len = snprintf(out, available, "%1.15g", value);
+		if (len > 0 && (size_t)len < available &&
+		    strtod(out, NULL) != value) {
+			len = snprintf(out, available, "%1.17g", value);
+		}
+	}
+
+	number_commit(w, len, available);
+}
+
+void codec_writer_number_prec(struct codec_writer *w, const char *key,
+			      double value, uint8_t decimals)
+{
+	char *out;
+	size_t available;
+	int len;
+
+	member_write(w, key);
+
+	if (!space_check(w, 0)) {
+		return;
+	}
+
+	out = (char *)&w->buf[w->len];
+	available = w->size - w->len;
+
+	if (isnan(value) || isinf(value)) {
+		number_commit(w, snprintf(out, available, "null"), available);
+		return;
+	}
+
+	len = snprintf(out, available, "%.*f", decimals, value);
+	if (len < 0 || (size_t)len >= available) {
+		number_commit(w, len, available);
+		return;
+	}
+
+	/* Drop trailing zeros of the fraction and a bare decimal point. */
+	if (decimals > 0) {
+		while (out[len - 1] == '0') {
+			len--;
+		}
+
+		if (out[len - 1] == '.') {
+			len--;
+		}
+	}
+
+	/* Values that round to zero are not printed as "-0". */
+	if ((len == 2) && (out[0] == '-') && (out[1] == '0')) {
+		out[0] = '0';
+		len = 1;
+	}
+
+	number_commit(w, len, available);
+}
+
+void codec_writer_bool(struct codec_writer *w, const char *key, bool value)
+{
+	member_write(w, key);
+
+	if (value) {
+		raw_write(w, "true", 4);
+	} else {
+		raw_write(w, "false", 5);
+	}
+}
+
+void codec_writer_str(struct codec_writer *w, const char *key,
+		      const char *value)
+{
+	member_write(w, key);
+
+	if (value == NULL) {
+		raw_write(w, "null", 4);
+		return;
+	}
+
+	str_write(w, value);
+}
+
+void codec_writer_encoded(struct codec_writer *w, const char *key,
+			  const void *data, size_t len)
+{
+	member_write(w, key);
+	raw_write(w, data, len);
+}
+
+size_t codec_writer_close_len(const struct codec_writer *w)
+{
+	/* One closing character per level and the NULL terminator. */
+	return w->depth + 1;
+}
+
+int codec_writer_finish(struct codec_writer *w)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	if (w->depth != 0) {
+		return -EINVAL;
+	}
+
+	/* space_check() always keeps room for the terminator. */
+	w->buf[w->len] = '\0';
+
+	return 0;
+}
+
+/* Maximum nesting depth of decoded messages. */
+#define JSON_DEPTH_MAX 16
+
+/* Single pass decoder of configuration messages. It does not build a tree
+ * of the message, only the keys leading to the current value are kept in a
+ * bounded array on the stack.
+ */
+struct json_reader {
+	const char *buf;
+	size_t len;
+	size_t pos;
+};
+
+struct json_token {
+	const char *start;
+	size_t len;
+};
+
+static bool token_matches(const struct json_token *token, const char *str)
+{
+	return (strlen(str) == token->len) &&
+	       (memcmp(token->start, str, token->len) == 0);
+}
+
+static void ws_skip(struct json_reader *r)
+{
+	while ((r->pos < r->len) &&
+	       ((r->buf[r->pos] == ' ') || (r->buf[r->pos] == '\t') ||
+		(r->buf[r->pos] == '\n') || (r->buf[r->pos] == '\r'))) {
+		r->pos++;
+	}
+}
+
+static int char_peek(struct json_reader *r)
+{
+	ws_skip(r);
+
+	return (r->pos < r->len) ? r->buf[r->pos] : -1;
+}
+
+static bool char_read(struct json_reader *r, char c)
+{
+	if (char_peek(r) != c) {
+		return false;
+	}
+
+	r->pos++;
+	return true;
+}
+
+/* Read a string. The token points to the raw content between the quotes,
+ * escape sequences are skipped but not resolved.
+ */
+static int string_read(struct json_reader *r, struct json_token *token)
+{
+	if (!char_read(r, '"')) {
+		return -ENOENT;
+	}
+
+	token->start = &r->buf[r->pos];
+
+	while (r->pos < r->len) {
+		char c = r->buf[r->pos++];
+
+		if (c == '"') {
+			token->len = &r->buf[r->pos - 1] - token->start;
+			return 0;
+		}
+
+		if (c == '\\') {
+			r->pos++;
+		} else if ((unsigned char)c < 0x20) {
+			return -ENOENT;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static bool literal_read(struct json_reader *r, const char *literal)
+{
+	size_t len = strlen(literal);
+
+	if ((r->len - r->pos < len) ||
+	    (memcmp(&r->buf[r->pos], literal, len) != 0)) {
+		return false;
+	}
+
+	r->pos += len;
+	return true;
+}
+
+/* Read a number and convert it to an integer the same way cJSON computes
+ * valueint, saturating at the limits of int.
+ */
+static int number_read(struct json_reader *r, int *value)
+{
+	char num[32];
+	char *end;
+	size_t len = 0;
+	double d;
+
+	while ((r->pos + len < r->len) &&
+	       strchr("+-0123456789.eE", r->buf[r->pos + len]) &&
+	       (r->buf[r->pos + len] != '\0')) {
+		len++;
+	}
+
+	if ((len == 0) || (len >= sizeof(num))) {
+		return -ENOENT;
+	}
+
+	memcpy(num, &r->buf[r->pos], len);
+	num[len] = '\0';
+
+	d = strtod(num, &end);
+	if (end != &num[len]) {
+		return -ENOENT;
+	}
+
+	r->pos += len;
+
+	if (d >= INT_MAX) {
+		*value = INT_MAX;
+	} else if (d <= (double)INT_MIN) {
+		*value = INT_MIN;
+	} else {
+		*value = (int)d;
+	}
+
+	return 0;
+}
+
+/* The configuration is either found in a top level "cfg" object or in
+ * "state"."cfg".
+ */
+static bool cfg_path_matches(const struct json_token *path, size_t depth)
+{
+	return ((depth == 1) && token_matches(&path[0], "cfg")) ||
+	       ((depth == 2) && token_matches(&path[0], "state") &&
+		token_matches(&path[1], "cfg"));
+}
+
+/* Read the value found at path[0..depth - 1]. If the value is a member of a
+ * configuration object and has a number or boolean value it is applied to
+ * the configuration, all other values are skipped.
+ */
+static int value_read(struct json_reader *r, struct json_token *path,
+		      size_t depth, bool cfg_member,
+		      struct cloud_data_cfg *cfg)
+{
+	int err;
+	int value;
+	int c = char_peek(r);
+
+	if (depth >= JSON_DEPTH_MAX) {
+		return -E2BIG;
+	}
+
+	switch (c) {
+	case '{':
+		r->pos++;
+
+		if (char_read(r, '}')) {
+			return 0;
+		}
+
+		do {
+			err = string_read(r, &path[depth]);
+			if (err) {
+				return err;
+			}
+
+			if (!char_read(r, ':')) {
+				return -ENOENT;
+			}
+
+			err = value_read(r, path, depth + 1,
+					 cfg_path_matches(path, depth), cfg);
+			if (err) {
+				return err;
+			}
+		} while (char_read(r, ','));
+
+		return char_read(r, '}') ? 0 : -ENOENT;
+	case '[':
+		r->pos++;
+
+		if (char_read(r, ']')) {
+			return 0;
+		}
+
+		/* Array elements have no key. */
+		path[depth].start = NULL;
+		path[depth].len = 0;
+
+		do {
+			err = value_read(r, path, depth + 1, false, cfg);
+			if (err) {
+				return err;
+			}
+		} while (char_read(r, ','));
+
+		return char_read(r, ']') ? 0 : -ENOENT;
+	case '"':
+		return string_read(r, &path[depth]);
+	case 't':
+	case 'f':
+		if (literal_read(r, "true")) {
+			value = 1;
+		} else if (literal_read(r, "false")) {
+			value = 0;
+		} else {
+			return -ENOENT;
+		}
+
+		break;
+	case 'n':
+		return literal_read(r, "null") ? 0 : -ENOENT;
+	default:
+		err = number_read(r, &value);
+		if (err) {
+			return err;
+		}
+
+		break;
+	}
+
+	if (cfg_member) {
+		codec_cfg_value_set(cfg, path[depth - 1].start,
+				    path[depth - 1].len, value);
+	}
+
+	return 0;
+}
+
+int codec_backend_cfg_decode(const char *input, size_t len,
+			     struct cloud_data_cfg *cfg)
+{
+	int err;
+	struct json_token path[JSON_DEPTH_MAX];
+	struct json_reader reader = {
+		.buf = input,
+		.len = len,
+	};
+
+	LOG_HEXDUMP_DBG(input, len, "Decoding message");
+
+	err = value_read(&reader, path, 0, false, cfg);
+	if (err) {
+		LOG_ERR("Failed to decode message at offset %zu, error: %d",
+			reader.pos, err);
+		return err;
+	}
+
+	/* Allow a NULL terminator to be included in the length. */
+	if ((char_peek(&reader) != -1) && (char_peek(&reader) != '\0')) {
+		LOG_ERR("Trailing data after message at offset %zu",
+			reader.pos);
+		return -ENOENT;
+	}
+
+	return 0;
+}
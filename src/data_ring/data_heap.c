@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include "data_heap.h"
+
+static int32_t key_at(const struct data_heap *heap, size_t index)
+{
+	return heap->key(data_ring_get(heap->ring, index));
+}
+
+static bool heap_less(const struct data_heap *heap, size_t a, size_t b)
+{
+	return key_at(heap, a) < key_at(heap, b);
+}
+
+static void heap_swap(struct data_heap *heap, size_t a, size_t b)
+{
+	data_ring_swap(heap->ring, a, b);
+
+	if (heap->newest == a) {
+		heap->newest = b;
+	} else if (heap->newest == b) {
+		heap->newest = a;
+	}
+}
+
+static void heap_sift_down(struct data_heap *heap, size_t index)
+{
+	size_t count = data_ring_count(heap->ring);
+	size_t child;
+
+	while (true) {
+		child = 2 * index + 1;
+		if (child >= count) {
+			return;
+		}
+
+		if ((child + 1 < count) && heap_less(heap, child + 1, child)) {
+			child++;
+		}
+
+		if (!heap_less(heap, child, index)) {
+			return;
+		}
+
+		heap_swap(heap, index, child);
+		index = child;
+	}
+}
+
+static void heap_sift_up(struct data_heap *heap, size_t index)
+{
+	size_t parent;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+		if (!heap_less(heap, index, parent)) {
+			return;
+		}
+
+		heap_swap(heap, index, parent);
+		index = parent;
+	}
+}
+
+/* Rebuild the heap and find the newest entry after the ring was changed
+ * elsewhere. Runs in linear time, at most once per publication.
+ */
+static void heap_restore(struct data_heap *heap)
+{
+	size_t count = data_ring_count(heap->ring);
+	int64_t newest_time = INT64_MIN;
+	int64_t time;
+
+	if (heap->valid &&
+	    (data_ring_dropped(heap->ring) == heap->dropped)) {
+		return;
+	}
+
+	for (size_t i = count / 2; i-- > 0;) {
+		heap_sift_down(heap, i);
+	}
+
+	heap->newest = 0;
+
+	for (size_t i = 0; i < count; i++) {
+		time = heap->time(data_ring_get(heap->ring, i));
+		if (time >= newest_time) {
+			newest_time = time;
+			heap->newest = i;
+		}
+	}
+
+	heap->dropped = data_ring_dropped(heap->ring);
+	heap->valid = true;
+}
+
+bool data_heap_put(struct data_heap *heap, const void *entry)
+{
+	struct data_ring *ring = heap->ring;
+	void *weakest;
+
+	heap_restore(heap);
+
+	if (data_ring_is_full(ring)) {
+		/* Either the new or the weakest entry is dropped. Counted
+		 * in the ring like the drops of the pool, without making the
+		 * heap look changed.
+		 */
+		ring->dropped++;
+		heap->dropped++;
+
+		weakest = data_ring_get(ring, 0);
+		if (heap->key(entry) <= heap->key(weakest)) {
+			data_ring_release(ring, entry);
+			return false;
+		}
+
+		data_ring_release(ring, weakest);
+		memcpy(weakest, entry, ring->entry_size);
+		heap->newest = 0;
+		heap_sift_down(heap, 0);
+
+		return true;
+	}
+
+	if (!data_ring_put(ring, entry)) {
+		return false;
+	}
+
+	/* The heap is rebuilt if the pool evicted an entry of the ring to
+	 * make room.
+	 */
+	heap->newest = data_ring_count(ring) - 1;
+	heap_sift_up(heap, heap->newest);
+	heap_restore(heap);
+
+	return true;
+}
+
+void *data_heap_newest(struct data_heap *heap)
+{
+	heap_restore(heap);
+
+	return data_ring_get(heap->ring, heap->newest);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Data ring that keeps the entries with the highest key.
+ */
+
+#ifndef DATA_HEAP_H__
+#define DATA_HEAP_H__
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "data_ring.h"
+
+/**@file
+ *
+ * @defgroup data_heap Data heap
+ * @brief    Order of a data ring that keeps the entries with the highest key
+ *	     once the ring is full.
+ *
+ * The entries of the ring are ordered as a binary min-heap on their key, so
+ * the entry with the lowest key, the one that a new entry replaces when the
+ * ring is full, is always at index 0. The index of the newest entry is
+ * tracked next to it. Other operations on the ring, evictions by the pool
+ * and removing published entries, break the order. The heap is then rebuilt
+ * on next use, which is linear in the number of entries.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct data_heap {
+	/** Ring that holds the entries. */
+	struct data_ring *ring;
+	/** Key of an entry, the entries with the highest keys are kept. */
+	int32_t (*key)(const void *entry);
+	/** Sampling time of an entry, the newest entry has the highest. */
+	int64_t (*time)(const void *entry);
+	/** Index of the newest entry. */
+	size_t newest;
+	/** Whether the ring is ordered as a heap. */
+	bool valid;
+	/** Dropped count of the ring when the heap was built. */
+	uint32_t dropped;
+};
+
+/**
+ * @brief Statically define a heap on a ring.
+ *
+ * @param _name Name of the heap.
+ * @param _ring Ring that holds the entries.
+ * @param _key Function that returns the key of an entry.
+ * @param _time Function that returns the sampling time of an entry.
+ */
+#define DATA_HEAP_DEFINE(_name, _ring, _key, _time)                            \
+	static struct data_heap _name = {                                      \
+		.ring = &_ring,                                                \
+		.key = _key,                                                   \
+		.time = _time,                                                 \
+	}
+
+/**
+ * @brief Add an entry. If the ring is full the entry replaces the entry with
+ *	  the lowest key, unless its own key is not higher. The entry that is
+ *	  not kept is counted in the dropped entries of the ring.
+ *
+ * @param[in,out] heap Pointer to heap.
+ * @param[in] entry Entry that is copied into the ring.
+ *
+ * @return true if the entry was added, false if it was dropped.
+ */
+bool data_heap_put(struct data_heap *heap, const void *entry);
+
+/**
+ * @brief Get the newest entry.
+ *
+ * @param[in,out] heap Pointer to heap.
+ *
+ * @return Pointer to the entry or NULL if the ring is empty.
+ */
+void *data_heap_newest(struct data_heap *heap);
+
+/**
+ * @brief Rebuild the heap on next use. Called after the ring was changed
+ *	  other than with @ref data_heap_put.
+ *
+ * @param[in,out] heap Pointer to heap.
+ */
+static inline void data_heap_invalidate(struct data_heap *heap)
+{
+	heap->valid = false;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include <errno.h>
+#include "data_ring.h"
+
+static uint16_t *slot_at(const struct data_ring *ring, size_t index)
+{
+	size_t pos = ring->tail + index;
+
+	if (pos >= ring->size) {
+		pos -= ring->size;
+	}
+
+	return &ring->slots[pos];
+}
+
+static uint8_t *entry_at(const struct data_ring *ring, size_t index)
+{
+	struct data_pool *pool = ring->pool;
+
+	return pool->buf + *slot_at(ring, index) * pool->slot_size;
+}
+
+static void slot_free(struct data_pool *pool, uint16_t slot)
+{
+	pool->free[pool->free_count++] = slot;
+}
+
+void data_pool_init(struct data_pool *pool)
+{
+	for (size_t i = 0; i < pool->size; i++) {
+		pool->free[i] = pool->size - 1 - i;
+	}
+
+	pool->free_count = pool->size;
+	pool->rings = NULL;
+}
+
+int data_pool_ring_add(struct data_ring *ring)
+{
+	struct data_pool *pool = ring->pool;
+
+	if (ring->entry_size > pool->slot_size) {
+		return -EINVAL;
+	}
+
+	ring->tail = 0;
+	ring->count = 0;
+	ring->next = pool->rings;
+	pool->rings = ring;
+
+	return 0;
+}
+
+/* Free a slot for a new entry of a ring by evicting the oldest entry of the
+ * ring with the lowest priority. The ring itself is preferred among rings of
+ * equal priority. Returns false if only rings with a higher priority hold
+ * entries.
+ */
+static bool pool_evict(struct data_ring *ring)
+{
+	struct data_ring *victim = ring->count ? ring : NULL;
+
+	for (struct data_ring *r = ring->pool->rings; r != NULL; r = r->next) {
+		if ((r->count > 0) &&
+		    ((victim == NULL) || (r->priority < victim->priority))) {
+			victim = r;
+		}
+	}
+
+	if ((victim == NULL) || (victim->priority > ring->priority)) {
+		return false;
+	}
+
+	data_ring_pop(victim, 1);
+	victim->dropped++;
+
+	return true;
+}
+
+bool data_ring_put(struct data_ring *ring, const void *entry)
+{
+	struct data_pool *pool = ring->pool;
+	uint16_t *slot;
+
+	if (ring->count == ring->size) {
+		/* Overwrite the oldest entry. */
+		data_ring_pop(ring, 1);
+		ring->dropped++;
+	} else if ((pool->free_count == 0) && !pool_evict(ring)) {
+		ring->dropped++;
+		data_ring_release(ring, entry);
+		return false;
+	}
+
+	slot = slot_at(ring, ring->count);
+	*slot = pool->free[--pool->free_count];
+	memcpy(pool->buf + *slot * pool->slot_size, entry, ring->entry_size);
+	ring->count++;
+
+	return true;
+}
+
+void *data_ring_get(const struct data_ring *ring, size_t index)
+{
+	if (index >= ring->count) {
+		return NULL;
+	}
+
+	return entry_at(ring, index);
+}
+
+void *data_ring_newest(const struct data_ring *ring)
+{
+	if (ring->count == 0) {
+		return NULL;
+	}
+
+	return entry_at(ring, ring->count - 1);
+}
+
+void data_ring_pop(struct data_ring *ring, size_t count)
+{
+	count = MIN(count, ring->count);
+
+	for (size_t i = 0; i < count; i++) {
+		data_ring_release(ring, entry_at(ring, i));
+		slot_free(ring->pool, *slot_at(ring, i));
+	}
+
+	ring->tail += count;
+	if (ring->tail >= ring->size) {
+		ring->tail -= ring->size;
+	}
+
+	ring->count -= count;
+}
+
+void data_ring_newest_drop(struct data_ring *ring)
+{
+	if (ring->count > 0) {
+		ring->count--;
+		data_ring_release(ring, entry_at(ring, ring->count));
+		slot_free(ring->pool, *slot_at(ring, ring->count));
+	}
+}
+
+void data_ring_remove(struct data_ring *ring, size_t index)
+{
+	if (index >= ring->count) {
+		return;
+	}
+
+	data_ring_swap(ring, index, ring->count - 1);
+	data_ring_newest_drop(ring);
+}
+
+void data_ring_swap(struct data_ring *ring, size_t a, size_t b)
+{
+	uint16_t *slot_a;
+	uint16_t *slot_b;
+	uint16_t tmp;
+
+	if ((a >= ring->count) || (b >= ring->count) || (a == b)) {
+		return;
+	}
+
+	slot_a = slot_at(ring, a);
+	slot_b = slot_at(ring, b);
+
+	tmp = *slot_a;
+	*slot_a = *slot_b;
+	*slot_b = tmp;
+}
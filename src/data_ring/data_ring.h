@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Ring buffer of sampled data entries.
+ */
+
+#ifndef DATA_RING_H__
+#define DATA_RING_H__
+
+#include <zephyr.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**@file
+ *
+ * @defgroup data_ring Data ring
+ * @brief    Ring buffer that holds sampled data entries of one type until
+ *	     they are published.
+ *
+ * Every entry in the ring is queued for publication. The entries of all
+ * rings are held in the slots of one shared pool, and a ring takes slots
+ * from it up to its quota. When the ring has reached its quota a new entry
+ * replaces the oldest one. When the pool is exhausted the new entry takes
+ * the slot of the oldest entry of the ring with the lowest priority, which
+ * can be the ring itself. The new entry is dropped if all rings that hold
+ * entries have a higher priority. Every ring counts the entries it has lost.
+ *
+ * All operations run in constant time, except for adding an entry to an
+ * exhausted pool, which is linear in the number of rings.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct data_ring;
+
+struct data_pool {
+	/** Storage of the slots. */
+	uint8_t *buf;
+	/** Size of one slot. */
+	size_t slot_size;
+	/** Stack of free slot indexes. */
+	uint16_t *free;
+	/** Number of free slots. */
+	size_t free_count;
+	/** Number of slots. */
+	size_t size;
+	/** Rings that take their entries from the pool. */
+	struct data_ring *rings;
+};
+
+struct data_ring {
+	/** Pool that holds the entries. */
+	struct data_pool *pool;
+	/** Pool slot indexes of the entries, in ring order. */
+	uint16_t *slots;
+	/** Size of one entry. */
+	size_t entry_size;
+	/** Maximum number of entries, the quota of the ring in the pool. */
+	size_t size;
+	/** Index in slots of the oldest entry. */
+	size_t tail;
+	/** Number of entries. */
+	size_t count;
+	/** Entries of rings with a lower priority are evicted first. */
+	uint8_t priority;
+	/** Number of entries that were dropped before they were published. */
+	uint32_t dropped;
+	/** Called with every entry that leaves the ring or is not added to
+	 *  it, to release what the entry refers to. NULL if not needed.
+	 */
+	void (*release)(const void *entry);
+	/** Next ring of the pool. */
+	struct data_ring *next;
+};
+
+/**
+ * @brief Statically define a pool of slots. Every ring that takes entries
+ *	  from the pool is added with @ref data_pool_ring_add after
+ *	  @ref data_pool_init.
+ *
+ * @param _name Name of the pool.
+ * @param _type Type of the slots, usually a union of the entry types of all
+ *		rings of the pool.
+ * @param _size Number of slots.
+ */
+#define DATA_POOL_DEFINE(_name, _type, _size)                                  \
+	BUILD_ASSERT((_size) <= UINT16_MAX);                                   \
+	static _type _name##_entries[_size];                                   \
+	static uint16_t _name##_free[_size];                                   \
+	static struct data_pool _name = {                                      \
+		.buf = (uint8_t *)_name##_entries,                             \
+		.slot_size = sizeof(_type),                                    \
+		.free = _name##_free,                                          \
+		.size = _size,                                                 \
+	}
+
+/**
+ * @brief Statically define a ring of entries of a type.
+ *
+ * @param _name Name of the ring.
+ * @param _type Type of the entries.
+ * @param _size Maximum number of entries.
+ * @param _pool Pool that holds the entries.
+ * @param _priority Priority of the entries, higher is kept longer.
+ */
+#define DATA_RING_DEFINE(_name, _type, _size, _pool, _priority)                \
+	static uint16_t _name##_slots[_size];                                  \
+	static struct data_ring _name = {                                      \
+		.pool = &_pool,                                                \
+		.slots = _name##_slots,                                        \
+		.entry_size = sizeof(_type),                                   \
+		.size = _size,                                                 \
+		.priority = _priority,                                         \
+	}
+
+/**
+ * @brief Initialize a pool. All of its slots are free afterwards.
+ *
+ * @param[in,out] pool Pointer to pool.
+ */
+void data_pool_init(struct data_pool *pool);
+
+/**
+ * @brief Add a ring to the pool that holds its entries.
+ *
+ * @param[in,out] ring Pointer to ring.
+ *
+ * @return 0 on success or -EINVAL if the entries of the ring do not fit
+ *	   the slots of the pool.
+ */
+int data_pool_ring_add(struct data_ring *ring);
+
+/**
+ * @brief Add an entry as the newest entry of the ring. The oldest entry of
+ *	  the ring, or of a ring with a lower priority, is dropped if there is
+ *	  no room for it.
+ *
+ * @param[in,out] ring Pointer to ring.
+ * @param[in] entry Entry that is copied into the ring.
+ *
+ * @return true if the entry was added, false if it was dropped because the
+ *	   pool is exhausted and all other entries have a higher priority.
+ */
+bool data_ring_put(struct data_ring *ring, const void *entry);
+
+/**
+ * @brief Get an entry.
+ *
+ * @param[in] ring Pointer to ring.
+ * @param[in] index Index of the entry, 0 is the oldest entry.
+ *
+ * @return Pointer to the entry or NULL if there is no such entry.
+ */
+void *data_ring_get(const struct data_ring *ring, size_t index);
+
+/**
+ * @brief Get the newest entry.
+ *
+ * @return Pointer to the entry or NULL if the ring is empty.
+ */
+void *data_ring_newest(const struct data_ring *ring);
+
+/**
+ * @brief Drop the oldest entries.
+ *
+ * @param[in,out] ring Pointer to ring.
+ * @param[in] count Number of entries to drop. Limited to the number of
+ *		    entries in the ring.
+ */
+void data_ring_pop(struct data_ring *ring, size_t count);
+
+/** @brief Drop the newest entry, if any. */
+void data_ring_newest_drop(struct data_ring *ring);
+
+/**
+ * @brief Remove an entry. The newest entry takes its place, so the order of
+ *	  the remaining entries is not kept.
+ *
+ * @param[in,out] ring Pointer to ring.
+ * @param[in] index Index of the entry, 0 is the oldest entry.
+ */
+void data_ring_remove(struct data_ring *ring, size_t index);
+
+/**
+ * @brief Swap two entries. Indexes that do not refer to an entry are ignored.
+ *
+ * @param[in,out] ring Pointer to ring.
+ * @param[in] a Index of the first entry, 0 is the oldest entry.
+ * @param[in] b Index of the second entry.
+ */
+void data_ring_swap(struct data_ring *ring, size_t a, size_t b);
+
+/** @brief Get the number of free slots of a pool. */
+static inline size_t data_pool_free_count(const struct data_pool *pool)
+{
+	return pool->free_count;
+}
+
+/** @brief Get the number of entries. */
+static inline size_t data_ring_count(const struct data_ring *ring)
+{
+	return ring->count;
+}
+
+/** @brief Check whether the ring holds its maximum number of entries. */
+static inline bool data_ring_is_full(const struct data_ring *ring)
+{
+	return ring->count == ring->size;
+}
+
+/** @brief Release an entry that leaves the ring, see data_ring.release. */
+static inline void data_ring_release(const struct data_ring *ring,
+				     const void *entry)
+{
+	if (ring->release != NULL) {
+		ring->release(entry);
+	}
+}
+
+/**
+ * @brief Get the number of entries that were lost before they were
+ *	  published. Entries are lost when they are replaced by newer entries
+ *	  of the same ring, evicted for entries of rings with a higher
+ *	  priority or not added at all.
+ */
+static inline uint32_t data_ring_dropped(const struct data_ring *ring)
+{
+	return ring->dropped;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
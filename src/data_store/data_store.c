@@ -0,0 +1,357 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <zephyr.h>
+#include <string.h>
+#include <fs/fcb.h>
+#include <storage/flash_map.h>
+#include "data_store.h"
+
+#if defined(CONFIG_PARTITION_MANAGER_ENABLED)
+#include <pm_config.h>
+#define DATA_STORE_AREA_ID PM_DATA_STORAGE_ID
+#else
+#define DATA_STORE_AREA_ID FLASH_AREA_ID(storage)
+#endif
+
+#include <logging/log.h>
+LOG_MODULE_REGISTER(data_store, CONFIG_CAT_TRACKER_LOG_LEVEL);
+
+#define DATA_STORE_MAGIC 0x64617431
+#define DATA_STORE_VERSION 1
+#define DATA_STORE_SECTORS_MAX 64
+
+/* Record that marks all records up to and including its id as published. */
+#define RECORD_TYPE_CONSUMED 0xFF
+
+struct record_hdr {
+	/** Sequence number of the record, consumed id for markers. */
+	uint32_t id;
+	/** Type of the entry. */
+	uint8_t type;
+	uint8_t reserved[3];
+};
+
+static struct fcb fcb;
+static struct flash_sector sectors[DATA_STORE_SECTORS_MAX];
+static bool initialized;
+K_MUTEX_DEFINE(store_lock);
+
+/* Id of the next appended record. Ids start at 1. */
+static uint32_t next_id = 1;
+/* Id of the last published record, 0 if none. */
+static uint32_t consumed_id;
+/* Id and location of the last record read. A location without sector
+ * reads from the oldest record on.
+ */
+static uint32_t read_id;
+static struct fcb_entry read_loc;
+
+/* Offset of the data of a record within the flash area. */
+static off_t data_off(const struct fcb_entry *loc)
+{
+	return loc->fe_sector->fs_off + loc->fe_data_off;
+}
+
+static int hdr_read(const struct fcb_entry *loc, struct record_hdr *hdr)
+{
+	if (loc->fe_data_len < sizeof(*hdr)) {
+		return -EBADMSG;
+	}
+
+	return flash_area_read(fcb.fap, data_off(loc), hdr, sizeof(*hdr));
+}
+
+/* Erase the oldest sector to make room, or once all its records are
+ * published.
+ */
+static int sector_rotate(void)
+{
+	if (read_loc.fe_sector == fcb.f_oldest) {
+		memset(&read_loc, 0, sizeof(read_loc));
+	}
+
+	return fcb_rotate(&fcb);
+}
+
+static int record_append(const struct record_hdr *hdr, const void *data,
+			 size_t len)
+{
+	int err;
+	struct fcb_entry loc;
+	uint8_t record[sizeof(*hdr) + DATA_STORE_ENTRY_MAX] __aligned(4) = {
+		0
+	};
+	size_t record_len = sizeof(*hdr) + len;
+
+	memcpy(record, hdr, sizeof(*hdr));
+	if (len > 0) {
+		memcpy(record + sizeof(*hdr), data, len);
+	}
+
+	err = fcb_append(&fcb, record_len, &loc);
+	if (err == -ENOSPC) {
+		LOG_WRN("Data store full, oldest entries dropped");
+
+		err = sector_rotate();
+		if (err) {
+			return err;
+		}
+
+		err = fcb_append(&fcb, record_len, &loc);
+	}
+
+	if (err) {
+		return err;
+	}
+
+	/* The record is padded to the write block size of the flash. */
+	err = flash_area_write(fcb.fap, data_off(&loc), record,
+			       ROUND_UP(record_len, fcb.f_align));
+	if (err) {
+		return err;
+	}
+
+	return fcb_append_finish(&fcb, &loc);
+}
+
+static int fcb_setup(void)
+{
+	int err;
+	uint32_t sector_cnt = ARRAY_SIZE(sectors);
+	const struct flash_area *fap;
+
+	err = flash_area_get_sectors(DATA_STORE_AREA_ID, &sector_cnt, sectors);
+	if (err) {
+		LOG_ERR("flash_area_get_sectors, error: %d", err);
+		return err;
+	}
+
+	fcb.f_magic = DATA_STORE_MAGIC;
+	fcb.f_version = DATA_STORE_VERSION;
+	fcb.f_sectors = sectors;
+	fcb.f_sector_cnt = sector_cnt;
+	fcb.f_scratch_cnt = 0;
+
+	err = fcb_init(DATA_STORE_AREA_ID, &fcb);
+	if (err == 0) {
+		return 0;
+	}
+
+	/* Unknown or corrupt content, start over with an empty store. */
+	LOG_WRN("Data store not recognized, erasing, error: %d", err);
+
+	err = flash_area_open(DATA_STORE_AREA_ID, &fap);
+	if (err) {
+		return err;
+	}
+
+	err = flash_area_erase(fap, 0, fap->fa_size);
+	flash_area_close(fap);
+	if (err) {
+		return err;
+	}
+
+	return fcb_init(DATA_STORE_AREA_ID, &fcb);
+}
+
+/* Recover the id sequence and the published position from the records.
+ * Returns the number of unpublished records.
+ */
+static size_t records_recover(void)
+{
+	struct fcb_entry loc = { 0 };
+	struct record_hdr hdr;
+	uint32_t last_id = 0;
+	size_t pending = 0;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		if (hdr_read(&loc, &hdr)) {
+			continue;
+		}
+
+		if (hdr.type == RECORD_TYPE_CONSUMED) {
+			consumed_id = MAX(consumed_id, hdr.id);
+		} else {
+			last_id = MAX(last_id, hdr.id);
+		}
+	}
+
+	memset(&loc, 0, sizeof(loc));
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		if ((hdr_read(&loc, &hdr) == 0) &&
+		    (hdr.type != RECORD_TYPE_CONSUMED) &&
+		    (hdr.id > consumed_id)) {
+			pending++;
+		}
+	}
+
+	next_id = last_id + 1;
+	read_id = consumed_id;
+
+	return pending;
+}
+
+int data_store_init(void)
+{
+	int err;
+
+	/* Start from the content of the flash only, as after a reboot. */
+	initialized = false;
+	consumed_id = 0;
+	memset(&read_loc, 0, sizeof(read_loc));
+	memset(&fcb, 0, sizeof(fcb));
+
+	err = fcb_setup();
+	if (err) {
+		LOG_ERR("Data store not initialized, error: %d", err);
+		return err;
+	}
+
+	LOG_INF("Data store: %d entries recovered", records_recover());
+
+	initialized = true;
+
+	return 0;
+}
+
+int data_store_append(uint8_t type, const void *data, size_t len)
+{
+	int err;
+	struct record_hdr hdr = { .type = type };
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	if ((type > DATA_STORE_TYPE_MAX) || (len > DATA_STORE_ENTRY_MAX)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	hdr.id = next_id;
+
+	err = record_append(&hdr, data, len);
+	if (err == 0) {
+		next_id++;
+	}
+
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+int data_store_read(uint8_t *type, void *data, size_t size, size_t *len)
+{
+	int err = -ENODATA;
+	struct record_hdr hdr;
+	struct fcb_entry loc;
+	size_t data_len;
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	/* Iterate on a copy, fcb_getnext() leaves the location past the last
+	 * record when it fails and records appended later would be skipped.
+	 */
+	loc = read_loc;
+
+	while (fcb_getnext(&fcb, &loc) == 0) {
+		read_loc = loc;
+
+		if (hdr_read(&read_loc, &hdr) ||
+		    (hdr.type == RECORD_TYPE_CONSUMED) || (hdr.id <= read_id)) {
+			continue;
+		}
+
+		read_id = hdr.id;
+		data_len = read_loc.fe_data_len - sizeof(hdr);
+
+		if (data_len > size) {
+			LOG_WRN("Stored entry of %d bytes skipped", data_len);
+			continue;
+		}
+
+		err = flash_area_read(fcb.fap,
+				      data_off(&read_loc) + sizeof(hdr), data,
+				      data_len);
+		if (err == 0) {
+			*type = hdr.type;
+			*len = data_len;
+		}
+
+		break;
+	}
+
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+int data_store_consume(void)
+{
+	int err = 0;
+	struct record_hdr hdr = { .type = RECORD_TYPE_CONSUMED };
+
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	if (read_id == consumed_id) {
+		goto exit;
+	}
+
+	hdr.id = read_id;
+
+	err = record_append(&hdr, NULL, 0);
+	if (err) {
+		LOG_ERR("Published position not stored, error: %d", err);
+		goto exit;
+	}
+
+	consumed_id = read_id;
+
+	/* All records in sectors before the one last read from are
+	 * published.
+	 */
+	while ((read_loc.fe_sector != NULL) &&
+	       (fcb.f_oldest != read_loc.fe_sector) &&
+	       (fcb.f_oldest != fcb.f_active.fe_sector)) {
+		err = sector_rotate();
+		if (err) {
+			LOG_ERR("fcb_rotate, error: %d", err);
+			break;
+		}
+	}
+
+exit:
+	k_mutex_unlock(&store_lock);
+
+	return err;
+}
+
+int data_store_rewind(void)
+{
+	if (!initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	read_id = consumed_id;
+	memset(&read_loc, 0, sizeof(read_loc));
+
+	k_mutex_unlock(&store_lock);
+
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Flash log of sampled data entries.
+ */
+
+#ifndef DATA_STORE_H__
+#define DATA_STORE_H__
+
+#include <zephyr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**@file
+ *
+ * @defgroup data_store Data store
+ * @brief    Log of sampled data entries in flash, kept until the entries are
+ *	     published.
+ *
+ * Entries are appended to a flash circular buffer, which writes its sectors
+ * in turn and erases a sector only once all entries in it are published, or
+ * when the store is full. Entries are read back in the order they were
+ * appended and are marked as published in flash once the caller has
+ * published them. Unpublished entries are recovered on boot.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum size of one entry. */
+#define DATA_STORE_ENTRY_MAX 64
+
+/** Types of entries 0xFF and above are reserved. */
+#define DATA_STORE_TYPE_MAX 0xFE
+
+/**
+ * @brief Initialize the store and recover unpublished entries. Entries that
+ *	  were read but not consumed before are read again.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
+int data_store_init(void);
+
+/**
+ * @brief Append an entry. If the store is full the oldest flash sector is
+ *	  erased and its entries are lost.
+ *
+ * @param[in] type Type of the entry, at most DATA_STORE_TYPE_MAX.
+ * @param[in] data Entry.
+ * @param[in] len Length of the entry, at most DATA_STORE_ENTRY_MAX.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
+int data_store_append(uint8_t type, const void *data, size_t len);
+
+/**
+ * @brief Read the next unpublished entry. Entries are read in the order they
+ *	  were appended.
+ *
+ * @param[out] type Type of the entry.
+ * @param[out] data Buffer that the entry is read into.
+ * @param[in] size Size of the buffer. Longer entries are skipped.
+ * @param[out] len Length of the entry.
+ *
+ * @return 0 on success, -ENODATA if all entries have been read or negative
+ *	   error value on failure.
+ */
+int data_store_read(uint8_t *type, void *data, size_t size, size_t *len);
+
+/**
+ * @brief Mark all entries read so far as published. Flash sectors that only
+ *	  hold published entries are erased.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
+int data_store_consume(void);
+
+/**
+ * @brief Read the entries after the last consumed one again, for instance
+ *	  when publishing the entries read so far failed.
+ *
+ * @return 0 on success or negative error value on failure.
+ */
+int data_store_rewind(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -25,7 +25,13 @@
 #include "ext_sensors.h"
 #include "watchdog.h"
 #include "cloud_codec.h"
+#include "data_ring.h"
+#include "data_heap.h"
+#include "sample_queue.h"
 #include "ui.h"
+#if defined(CONFIG_DATA_STORE)
+#include "data_store.h"
+#endif
 
 #include <logging/log.h>
 #include <logging/log_ctrl.h>
@@ -59,6 +65,9 @@ LOG_MODULE_REGISTER(cat_tracker, CONFIG_CAT_TRACKER_LOG_LEVEL);
 #define GPS_TIMEOUT_SECONDS 60
 #define DEVICE_MODE true
 
+/* Maximum number of samples of a type that wait to be added to the buffers. */
+#define SAMPLE_QUEUE_SIZE 4
+
 /* Time between cloud re-connection attempts. */
 #define CLOUD_RECONNECTION_INTERVAL 30
 
@@ -69,24 +78,151 @@ LOG_MODULE_REGISTER(cat_tracker, CONFIG_CAT_TRACKER_LOG_LEVEL);
 
 enum app_endpoint_type { CLOUD_EP_TOPIC_MESSAGES = CLOUD_EP_PRIV_START };
 
-/* Circular buffers. All data sent to cloud are stored in cicular buffers.
- * Upon a LTE connection loss the device will keep sampling/storing data in
- * the buffers, and empty the buffers in batches upon a reconnect.
+/* Ring buffers. All data sent to cloud are stored in ring buffers until
+ * published. Upon a LTE connection loss the device will keep sampling/storing
+ * data in the rings, and empty them in batches upon a reconnect. The entries
+ * of all rings share one pool, in which every ring has a quota and a
+ * priority.
+ */
+union data_entry {
+	struct cloud_data_gps gps;
+	struct cloud_data_sensors sensors;
+	struct cloud_data_modem modem;
+	struct cloud_data_ui ui;
+	struct cloud_data_accelerometer accel;
+	struct cloud_data_battery bat;
+};
+
+DATA_POOL_DEFINE(data_pool, union data_entry, CONFIG_DATA_POOL_SIZE);
+DATA_RING_DEFINE(gps_ring, struct cloud_data_gps, CONFIG_GPS_BUFFER_MAX,
+		 data_pool, CONFIG_GPS_BUFFER_PRIORITY);
+DATA_RING_DEFINE(sensor_ring, struct cloud_data_sensors,
+		 CONFIG_SENSOR_BUFFER_MAX, data_pool,
+		 CONFIG_SENSOR_BUFFER_PRIORITY);
+DATA_RING_DEFINE(modem_ring, struct cloud_data_modem, CONFIG_MODEM_BUFFER_MAX,
+		 data_pool, CONFIG_MODEM_BUFFER_PRIORITY);
+DATA_RING_DEFINE(ui_ring, struct cloud_data_ui, CONFIG_UI_BUFFER_MAX,
+		 data_pool, CONFIG_UI_BUFFER_PRIORITY);
+DATA_RING_DEFINE(accel_ring, struct cloud_data_accelerometer,
+		 CONFIG_ACCEL_BUFFER_MAX, data_pool,
+		 CONFIG_ACCEL_BUFFER_PRIORITY);
+DATA_RING_DEFINE(bat_ring, struct cloud_data_battery, CONFIG_BAT_BUFFER_MAX,
+		 data_pool, CONFIG_BAT_BUFFER_PRIORITY);
+
+/* GPS fixes, accelerometer triggers and button presses are reported from the
+ * contexts of their drivers. The callbacks only convert a sample into an
+ * entry and hand it over through a lock-free queue. The entries are added to
+ * the rings from the sampling workqueue, under the same lock that
+ * publications hold while they read the rings.
  */
-static struct cloud_data_gps gps_buf[CONFIG_GPS_BUFFER_MAX];
-static struct cloud_data_sensors sensors_buf[CONFIG_SENSOR_BUFFER_MAX];
-static struct cloud_data_modem modem_buf[CONFIG_MODEM_BUFFER_MAX];
-static struct cloud_data_ui ui_buf[CONFIG_UI_BUFFER_MAX];
-static struct cloud_data_accelerometer accel_buf[CONFIG_ACCEL_BUFFER_MAX];
-static struct cloud_data_battery bat_buf[CONFIG_BAT_BUFFER_MAX];
-
-/** Head of circular buffers. */
-static int head_gps_buf;
-static int head_sensor_buf;
-static int head_modem_buf;
-static int head_ui_buf;
-static int head_accel_buf;
-static int head_bat_buf;
+SAMPLE_QUEUE_DEFINE(gps_queue, struct cloud_data_gps, SAMPLE_QUEUE_SIZE);
+SAMPLE_QUEUE_DEFINE(ui_queue, struct cloud_data_ui, SAMPLE_QUEUE_SIZE);
+SAMPLE_QUEUE_DEFINE(accel_queue, struct cloud_data_accelerometer,
+		    SAMPLE_QUEUE_SIZE);
+
+/* The accelerometer ring keeps the strongest movements. Its entries are
+ * ordered as a min-heap on their peak value. Publishing and loading stored
+ * entries reorder the ring, the heap is then rebuilt on next use.
+ */
+static int32_t accel_peak_get(const void *entry);
+static int64_t accel_time_get(const void *entry);
+DATA_HEAP_DEFINE(accel_heap, accel_ring, accel_peak_get, accel_time_get);
+
+/* Sampled data types, also the type of entries in the data store. */
+enum data_type {
+	DATA_GPS,
+	DATA_SENSORS,
+	DATA_MODEM,
+	DATA_UI,
+	DATA_ACCEL,
+	DATA_BAT,
+};
+
+struct data_queue {
+	/** Name of the type in log messages. */
+	const char *name;
+	/** Ring that entries of the type are queued in. */
+	struct data_ring *ring;
+	/** Offset of the uptime timestamp within an entry. */
+	size_t ts_offset;
+	/** Entries can be stored in flash. Modem entries refer to interned
+	 *  strings that do not outlive a reboot and can not.
+	 */
+	bool persistent;
+};
+
+static const struct data_queue data_queues[] = {
+	[DATA_GPS] = { "GPS", &gps_ring,
+		       offsetof(struct cloud_data_gps, gps_ts), true },
+	[DATA_SENSORS] = { "Sensor", &sensor_ring,
+			   offsetof(struct cloud_data_sensors, env_ts), true },
+	[DATA_MODEM] = { "Modem", &modem_ring,
+			 offsetof(struct cloud_data_modem, mod_ts), false },
+	[DATA_UI] = { "UI", &ui_ring, offsetof(struct cloud_data_ui, btn_ts),
+		      true },
+	[DATA_ACCEL] = { "Accelerometer", &accel_ring,
+			 offsetof(struct cloud_data_accelerometer, ts), true },
+	[DATA_BAT] = { "Battery", &bat_ring,
+		       offsetof(struct cloud_data_battery, bat_ts), true },
+};
+
+/* Number of dropped entries of every type that has been logged. */
+static uint32_t data_dropped_logged[ARRAY_SIZE(data_queues)];
+
+/* Buffer that the cloud codec encodes outgoing messages into. All publications
+ * are done from the publishing workqueue, one at a time. The buffer is handed
+ * to cloud_send() as is, and the MQTT library transmits the payload straight
+ * from it, so an encoded message is never copied.
+ */
+static char codec_buf[CONFIG_AWS_IOT_MQTT_PAYLOAD_BUFFER_LEN];
+
+/* The newest entries of every publication cycle are published in a message
+ * of their own. They pass three stages:
+ * - Sample: the sampling workqueue takes the modem and sensor sample and
+ *   copies the newest entries into a snapshot.
+ * - Encode: the publishing workqueue encodes the snapshot into its buffer.
+ *   Encoding takes more stack than sampling, and is kept off the sampling
+ *   workqueue for that reason.
+ * - Send: the publishing workqueue sends the message, publishes the buffered
+ *   data and frees the snapshot.
+ * A snapshot is handed to the next stage through a message queue. With two
+ * snapshots the next cycle is sampled while the previous one is published.
+ */
+#define SNAPSHOT_COUNT 2
+
+struct snapshot {
+	/** Id of the cycle of the state machine that the publication
+	 *  concludes, 0 if none.
+	 */
+	uint32_t cycle;
+	/** Newest entries, pointers to the copies below or NULL. */
+	struct cloud_data_gps *gps;
+	struct cloud_data_sensors *sensors;
+	struct cloud_data_modem *modem;
+	struct cloud_data_modem_static *modem_static;
+	struct cloud_data_accelerometer *accel;
+	struct cloud_data_battery *bat;
+	struct cloud_data_gps gps_entry;
+	struct cloud_data_sensors sensors_entry;
+	struct cloud_data_modem modem_entry;
+	struct cloud_data_modem_static modem_static_entry;
+	struct cloud_data_accelerometer accel_entry;
+	struct cloud_data_battery bat_entry;
+	/** Encoded message, empty if there is nothing to send. */
+	struct cloud_codec_data codec;
+	/** Reported values, committed once the message is published. */
+	struct cloud_codec_report report;
+	char buf[CONFIG_ENCODED_DATA_LEN_MAX];
+};
+
+static struct snapshot snapshots[SNAPSHOT_COUNT];
+
+K_MSGQ_DEFINE(snapshot_free_msgq, sizeof(struct snapshot *), SNAPSHOT_COUNT,
+	      4);
+K_MSGQ_DEFINE(snapshot_encode_msgq, sizeof(struct snapshot *),
+	      SNAPSHOT_COUNT, 4);
+K_MSGQ_DEFINE(snapshot_send_msgq, sizeof(struct snapshot *), SNAPSHOT_COUNT,
+	      4);
 
 /* Default device configuration. */
 static struct cloud_data_cfg cfg = { .gpst = GPS_TIMEOUT_SECONDS,
@@ -105,6 +241,16 @@ static char cfg_topic[CFG_TOPIC_LEN + 1];
 static char messages_topic[MESSAGES_TOPIC_LEN + 1];
 
 static struct modem_param_info modem_param;
+/* Modem data being read from the modem. The AT commands take long, they are
+ * sent into this copy without the data lock held, only from the sampling
+ * workqueue.
+ */
+static struct modem_param_info modem_param_read;
+/* Modem and device identity, published when it changes. Valid once the
+ * modem data has been sampled.
+ */
+static struct cloud_data_modem_static modem_static;
+static bool modem_static_valid;
 static struct cloud_backend *cloud_backend;
 
 static bool gps_fix;
@@ -112,24 +258,186 @@ static bool cloud_connected;
 
 static struct k_delayed_work device_config_get_work;
 static struct k_delayed_work device_config_send_work;
-static struct k_delayed_work data_send_work;
 static struct k_delayed_work buffered_data_send_work;
 static struct k_delayed_work ui_send_work;
 static struct k_delayed_work leds_set_work;
 static struct k_delayed_work mov_timeout_work;
 static struct k_delayed_work sample_data_work;
 static struct k_delayed_work cloud_connect_work;
+static struct k_work sample_ingest_work;
+static struct k_work snapshot_encode_work;
+static struct k_work snapshot_send_work;
+
+/* Sampling, publication and cloud connection each have a workqueue of their
+ * own, so a publication or connection attempt that stalls on the network does
+ * not delay sampling. The system workqueue is left to the watchdog, the LEDs
+ * and the buttons.
+ */
+static K_THREAD_STACK_DEFINE(sample_workq_stack,
+			     CONFIG_SAMPLE_WORKQUEUE_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(send_workq_stack,
+			     CONFIG_SEND_WORKQUEUE_STACK_SIZE);
+static K_THREAD_STACK_DEFINE(connection_workq_stack,
+			     CONFIG_CONNECTION_WORKQUEUE_STACK_SIZE);
+static struct k_work_q sample_workq;
+static struct k_work_q send_workq;
+static struct k_work_q connection_workq;
+
+/* Held while the buffer pool, its rings, the sampled modem data and the
+ * interned strings are accessed. Publications only hold it while encoding,
+ * never while transmitting.
+ */
+static K_MUTEX_DEFINE(data_lock);
+
+/* Publications that wait for the data sample preceding them. */
+#define PUBLISH_DATA BIT(0)
+#define PUBLISH_CFG BIT(1)
+/* The publication concludes a cycle of the application state machine, which
+ * is notified when its sample has been taken and when it has been sent.
+ */
+#define PUBLISH_CYCLE BIT(2)
+static atomic_t publish_pending;
+/* Id of the cycle that requested PUBLISH_CYCLE. */
+static atomic_t publish_cycle;
 
 /* Value that always holds the latest RSRP value. */
 static uint16_t rsrp_value_latest;
 
-/* Depend on this semaphore when in passive mode. Release only if the movement
- * of the subject breaks the set accelerometer threshold value. When the
- * sempahore is released the application performs its normal publish cycle.
+/* The application runs a cycle of GPS search, sampling and publication,
+ * followed by a sleep. In passive mode a new cycle waits for movement after
+ * the sleep. The cycle is driven from the main thread by the events below,
+ * which are posted from driver callbacks, timers and workqueues.
+ */
+enum app_state {
+	/* Passive mode, waiting for movement. */
+	STATE_IDLE,
+	STATE_GPS_SEARCH,
+	/* Taking the modem and sensor sample that is published. */
+	STATE_SAMPLING,
+	/* Waiting for the publication to be sent. The sleep has started and
+	 * the next cycle can start before the publication is sent.
+	 */
+	STATE_PUBLISHING,
+	STATE_SLEEPING,
+};
+
+enum app_event {
+	/* Movement detected or movement timeout. */
+	APP_EVT_MOVEMENT,
+	/* Sleep elapsed. */
+	APP_EVT_TIMER,
+	/* GPS fix obtained or GPS search timed out. */
+	APP_EVT_GPS,
+	/* Device configuration received. */
+	APP_EVT_CONFIG,
+	APP_EVT_CLOUD_CONNECTED,
+	APP_EVT_CLOUD_DISCONNECTED,
+	/* Sample of the cycle taken. */
+	APP_EVT_SAMPLED,
+	/* Publication of the cycle sent, or dropped if not connected. */
+	APP_EVT_PUBLISHED,
+	/* The modem entered RRC connected or idle mode. */
+	APP_EVT_RRC_CONNECTED,
+	APP_EVT_RRC_IDLE,
+};
+
+#define APP_EVENT_QUEUE_SIZE 16
+
+K_MSGQ_DEFINE(app_msgq, sizeof(enum app_event), APP_EVENT_QUEUE_SIZE, 4);
+
+/* The state machine waits for these events to move on, they must not be
+ * lost when the event queue is full. They are pending in a bit per enum
+ * app_event until handled, and only posted to the queue to wake up the main
+ * thread. An event posted again while it is pending is handled once.
+ */
+#define APP_EVT_LOSSLESS (BIT(APP_EVT_TIMER) | BIT(APP_EVT_SAMPLED) | \
+			  BIT(APP_EVT_PUBLISHED))
+
+static atomic_t app_evt_pending;
+
+static enum app_state app_state;
+/* Id of the current cycle, counted up when a cycle starts. */
+static uint32_t cycle_id;
+/* Ids of the last cycle that was sampled and of the last cycle whose
+ * publication was sent. Events of an earlier cycle are stale and ignored.
+ */
+static atomic_t cycle_sampled;
+static atomic_t cycle_published;
+/* Movement was detected since the cycle started. */
+static bool movement_pending;
+/* Uptime when the sleep started. */
+static int64_t sleep_start;
+
+/* Every RRC connection is followed by an inactivity timer that keeps the
+ * radio on for seconds after the last transmission. Messages are therefore
+ * sent right away only if the modem is in RRC connected mode or if they are
+ * urgent. Others are held and sent back-to-back with the publication of the
+ * next cycle or once the modem is RRC connected for another reason.
+ */
+enum tx_msg {
+	TX_CFG_GET,
+	TX_CFG_SEND,
+	TX_BUFFERED,
+	TX_UI,
+};
+
+static void tx_schedule(enum tx_msg msg, bool urgent);
+
+static atomic_t rrc_connected;
+/* Messages held until the next radio window, a bit per enum tx_msg. */
+static atomic_t tx_held;
+/* Time the modem spent in RRC connected mode during the current cycle.
+ * Accounted from the main thread.
+ */
+static int64_t rrc_connected_start;
+static int64_t rrc_connected_ms;
+
+static void app_event_post(enum app_event evt)
+{
+	if (BIT(evt) & APP_EVT_LOSSLESS) {
+		/* The main thread is already woken up, or is handling
+		 * events of a full queue and sees the event next.
+		 */
+		if (atomic_test_and_set_bit(&app_evt_pending, evt)) {
+			return;
+		}
+	}
+
+	if (k_msgq_put(&app_msgq, &evt, K_NO_WAIT)) {
+		if (BIT(evt) & APP_EVT_LOSSLESS) {
+			return;
+		}
+
+		LOG_WRN("Event queue full, event %d dropped", evt);
+	}
+}
+
+/* Post that the sample of a cycle was taken or that its publication was
+ * sent.
+ */
+static void cycle_event_post(enum app_event evt, uint32_t cycle)
+{
+	atomic_set(evt == APP_EVT_SAMPLED ? &cycle_sampled : &cycle_published,
+		   cycle);
+	app_event_post(evt);
+}
+
+static void sleep_timer_fn(struct k_timer *timer)
+{
+	app_event_post(APP_EVT_TIMER);
+}
+
+static K_TIMER_DEFINE(sleep_timer, sleep_timer_fn, NULL);
+
+/* Stop the sleep timer. An expiry that is still pending belongs to the sleep
+ * that is cut short and is dropped.
  */
-static K_SEM_DEFINE(accel_trig_sem, 0, 1);
-/* Give this semaphore when the GPS either obtains a fix or times out. */
-static K_SEM_DEFINE(gps_timeout_sem, 0, 1);
+static void sleep_timer_stop(void)
+{
+	k_timer_stop(&sleep_timer);
+	atomic_clear_bit(&app_evt_pending, APP_EVT_TIMER);
+}
+
 /* Give this semaphore when the device has a successful LTE connection. */
 static K_SEM_DEFINE(lte_conn_sem, 0, 1);
 /* Give this semaphore when the date time library has tried to obtain time. */
@@ -205,7 +513,7 @@ static void gps_time_set(struct gps_pvt *gps_data)
 
 static void leds_set(void)
 {
-	if (!k_sem_count_get(&gps_timeout_sem)) {
+	if (app_state != STATE_GPS_SEARCH) {
 		if (!cfg.act) {
 			ui_led_set_pattern(UI_LED_PASSIVE_MODE);
 		} else {
@@ -216,149 +524,395 @@ static void leds_set(void)
 	}
 }
 
-static void battery_buffer_populate(void)
+static uint32_t *entry_ts_get(enum data_type type, void *entry)
+{
+	return (uint32_t *)((uint8_t *)entry + data_queues[type].ts_offset);
+}
+
+#if defined(CONFIG_DATA_STORE)
+/* Entry in the data store. The timestamp of the entry does not hold UNIX
+ * time, it is stored in front of the entry.
+ */
+struct stored_entry {
+	/** UNIX time the entry was sampled at. */
+	int64_t ts;
+	/** Entry. */
+	uint8_t data[DATA_STORE_ENTRY_MAX - sizeof(int64_t)];
+};
+
+/* Maximum number of entries that wait to be appended to the data store. */
+#define STORE_QUEUE_SIZE 8
+
+struct store_request {
+	enum data_type type;
+	struct stored_entry stored;
+};
+
+/* Flash writes and the sector erases they trigger are slow and take more
+ * stack than sampling needs. Entries are handed over to the publishing
+ * workqueue, which is idle while the cloud is not connected, and appended to
+ * the data store from there. All data store accesses are then made from the
+ * publishing workqueue.
+ */
+K_MSGQ_DEFINE(store_msgq, sizeof(struct store_request), STORE_QUEUE_SIZE, 8);
+static struct k_work store_work;
+#endif
+
+/* Keep an entry in its ring. */
+static void entry_keep(enum data_type type, void *entry)
+{
+	if (type == DATA_ACCEL) {
+		data_heap_put(&accel_heap, entry);
+	} else {
+		data_ring_put(data_queues[type].ring, entry);
+	}
+}
+
+/* Queue an entry that is sampled while the cloud is not connected to be
+ * appended to the data store, with its timestamp converted to UNIX time.
+ * Returns true if the entry was queued, otherwise it is to be kept in RAM.
+ */
+static bool entry_store(enum data_type type, void *entry)
+{
+#if defined(CONFIG_DATA_STORE)
+	int err;
+	struct store_request request = { .type = type };
+	size_t len = data_queues[type].ring->entry_size;
+
+	if (cloud_connected || !data_queues[type].persistent ||
+	    (len > sizeof(request.stored.data))) {
+		return false;
+	}
+
+	request.stored.ts = cloud_data_ts_uptime(*entry_ts_get(type, entry));
+
+	err = date_time_uptime_to_unix_time_ms(&request.stored.ts);
+	if (err) {
+		return false;
+	}
+
+	memcpy(request.stored.data, entry, len);
+
+	if (k_msgq_put(&store_msgq, &request, K_NO_WAIT)) {
+		LOG_WRN("Store queue full, entry kept in RAM");
+		return false;
+	}
+
+	k_work_submit_to_queue(&send_workq, &store_work);
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if defined(CONFIG_DATA_STORE)
+/* Append the queued entries to the data store. An entry that can not be
+ * appended is kept in RAM instead.
+ */
+static void store_work_fn(struct k_work *work)
+{
+	int err;
+	struct store_request request;
+	size_t len;
+
+	while (!k_msgq_get(&store_msgq, &request, K_NO_WAIT)) {
+		len = data_queues[request.type].ring->entry_size;
+
+		err = data_store_append(request.type, &request.stored,
+				       offsetof(struct stored_entry, data) +
+				       len);
+		if (!err) {
+			continue;
+		}
+
+		LOG_WRN("data_store_append, error: %d", err);
+
+		k_mutex_lock(&data_lock, K_FOREVER);
+		entry_keep(request.type, request.stored.data);
+		k_mutex_unlock(&data_lock);
+	}
+}
+#endif
+
+static void entry_queue(enum data_type type, void *entry)
+{
+	if (!entry_store(type, entry)) {
+		entry_keep(type, entry);
+	}
+}
+
+#if defined(CONFIG_DATA_STORE)
+/* Accelerometer entries loaded from the data store may still be in the
+ * ring, they are not published in active mode.
+ */
+static bool stored_accel_loaded;
+#endif
+
+/* Called once all published rings are drained, the entries loaded from the
+ * data store so far have then been sent. Mark them as published, unless
+ * loaded accelerometer entries are still waiting for passive mode.
+ */
+static void stored_data_consume(void)
 {
-	/* Go to start of buffer if end is reached. */
-	head_bat_buf += 1;
-	if (head_bat_buf == CONFIG_BAT_BUFFER_MAX) {
-		head_bat_buf = 0;
+#if defined(CONFIG_DATA_STORE)
+	if (stored_accel_loaded && (data_ring_count(&accel_ring) > 0)) {
+		return;
 	}
 
-	bat_buf[head_bat_buf].bat = modem_param.device.battery.value;
-	bat_buf[head_bat_buf].bat_ts = k_uptime_get();
-	bat_buf[head_bat_buf].queued = true;
+	stored_accel_loaded = false;
+	data_store_consume();
+#endif
+}
 
-	LOG_DBG("Entry: %d of %d in battery buffer filled", head_bat_buf,
-		CONFIG_BAT_BUFFER_MAX - 1);
+/* Called when sending buffered data failed. The entries loaded from the data
+ * store since they were last consumed are loaded again.
+ */
+static void stored_data_rewind(void)
+{
+#if defined(CONFIG_DATA_STORE)
+	data_store_rewind();
+#endif
 }
 
-static void gps_buffer_populate(struct gps_pvt *gps_data)
+/* Called once all rings are drained. Load the next entries of the data store
+ * into the rings for as long as the pool and every ring have room.
+ * Accelerometer entries are only published in passive mode and do not have
+ * to fit.
+ *
+ * Returns the number of loaded entries.
+ */
+static size_t stored_data_load(bool accel)
 {
-	/* Go to start of buffer if end is reached. */
-	head_gps_buf += 1;
-	if (head_gps_buf == CONFIG_GPS_BUFFER_MAX) {
-		head_gps_buf = 0;
+#if defined(CONFIG_DATA_STORE)
+	int err;
+	uint8_t type;
+	struct stored_entry stored;
+	size_t len;
+	size_t loaded = 0;
+	int64_t uptime = k_uptime_get();
+	int64_t unix_time = uptime;
+
+	/* Stored timestamps are converted back to uptime. */
+	if (date_time_uptime_to_unix_time_ms(&unix_time)) {
+		return 0;
+	}
+
+	while (data_pool_free_count(&data_pool) > 0) {
+		for (size_t i = 0; i < ARRAY_SIZE(data_queues); i++) {
+			if (data_queues[i].persistent &&
+			    ((i != DATA_ACCEL) || accel) &&
+			    data_ring_is_full(data_queues[i].ring)) {
+				return loaded;
+			}
+		}
+
+		err = data_store_read(&type, &stored, sizeof(stored), &len);
+		if (err) {
+			return loaded;
+		}
+
+		if ((type >= ARRAY_SIZE(data_queues)) ||
+		    !data_queues[type].persistent ||
+		    (len != offsetof(struct stored_entry, data) +
+				    data_queues[type].ring->entry_size)) {
+			LOG_WRN("Unknown stored entry of type %d skipped",
+				type);
+			continue;
+		}
+
+		*entry_ts_get(type, stored.data) =
+			cloud_data_ts(stored.ts - (unix_time - uptime));
+		data_ring_put(data_queues[type].ring, stored.data);
+		loaded++;
+
+		if (type == DATA_ACCEL) {
+			data_heap_invalidate(&accel_heap);
+			stored_accel_loaded = true;
+		}
 	}
 
-	gps_buf[head_gps_buf].longi = gps_data->longitude;
-	gps_buf[head_gps_buf].lat = gps_data->latitude;
-	gps_buf[head_gps_buf].alt = gps_data->altitude;
-	gps_buf[head_gps_buf].acc = gps_data->accuracy;
-	gps_buf[head_gps_buf].spd = gps_data->speed;
-	gps_buf[head_gps_buf].hdg = gps_data->heading;
-	gps_buf[head_gps_buf].gps_ts = k_uptime_get();
-	gps_buf[head_gps_buf].queued = true;
+	return loaded;
+#else
+	return 0;
+#endif
+}
+
+static void battery_buffer_populate(void)
+{
+	struct cloud_data_battery entry = {
+		.bat = modem_param_read.device.battery.value,
+		.bat_ts = cloud_data_ts(k_uptime_get()),
+	};
+
+	k_mutex_lock(&data_lock, K_FOREVER);
+	entry_queue(DATA_BAT, &entry);
+
+	LOG_DBG("Battery buffer: %d of %d entries queued",
+		data_ring_count(&bat_ring), CONFIG_BAT_BUFFER_MAX);
+	k_mutex_unlock(&data_lock);
+}
+
+static void gps_buffer_populate(struct cloud_data_gps *entry)
+{
+	entry_queue(DATA_GPS, entry);
+
+	LOG_DBG("GPS buffer: %d of %d entries queued",
+		data_ring_count(&gps_ring), CONFIG_GPS_BUFFER_MAX);
+}
+
+/* Called from the GPS driver. */
+static void gps_sample_queue(struct gps_pvt *gps_data)
+{
+	struct cloud_data_gps entry = {
+		.longi = cloud_data_fixed(gps_data->longitude,
+					  CLOUD_DATA_COORD_DECIMALS, INT32_MIN,
+					  INT32_MAX),
+		.lat = cloud_data_fixed(gps_data->latitude,
+					CLOUD_DATA_COORD_DECIMALS, INT32_MIN,
+					INT32_MAX),
+		.alt = cloud_data_fixed(gps_data->altitude,
+					CLOUD_DATA_GPS_DECIMALS, INT32_MIN,
+					INT32_MAX),
+		.acc = cloud_data_fixed(gps_data->accuracy,
+					CLOUD_DATA_GPS_DECIMALS, 0,
+					UINT16_MAX),
+		.spd = cloud_data_fixed(gps_data->speed,
+					CLOUD_DATA_GPS_DECIMALS, 0,
+					UINT16_MAX),
+		.hdg = cloud_data_fixed(gps_data->heading,
+					CLOUD_DATA_GPS_DECIMALS, 0,
+					UINT16_MAX),
+		.gps_ts = cloud_data_ts(k_uptime_get()),
+	};
 
-	LOG_DBG("Entry: %d of %d in GPS buffer filled", head_gps_buf,
-		CONFIG_GPS_BUFFER_MAX - 1);
+	if (sample_queue_put(&gps_queue, &entry)) {
+		LOG_WRN("GPS sample queue full, fix dropped");
+		return;
+	}
+
+	k_work_submit_to_queue(&sample_workq, &sample_ingest_work);
 }
 
-void acc_array_swap(struct cloud_data_accelerometer *xp,
-		    struct cloud_data_accelerometer *yp)
+/* Highest absolute value of the axes of an accelerometer entry. */
+static int32_t accel_peak_get(const void *entry)
 {
-	struct cloud_data_accelerometer temp = *xp;
-	*xp = *yp;
-	*yp = temp;
+	const struct cloud_data_accelerometer *accel = entry;
+	int32_t peak = 0;
+
+	for (int n = 0; n < ARRAY_SIZE(accel->values); n++) {
+		peak = MAX(peak, abs(accel->values[n]));
+	}
+
+	return peak;
+}
+
+static int64_t accel_time_get(const void *entry)
+{
+	const struct cloud_data_accelerometer *accel = entry;
+
+	return cloud_data_ts_uptime(accel->ts);
 }
 
 #if defined(CONFIG_EXTERNAL_SENSORS)
 static void
-accelerometer_buffer_populate(const struct ext_sensor_evt *const acc_data)
+accelerometer_buffer_populate(struct cloud_data_accelerometer *entry)
 {
-	static int buf_entry_try_again_timeout;
-	int j, k, n;
-	int i = 0;
-	double temp = 0;
-	double temp_ = 0;
-	int64_t newest_time = 0;
+	static int64_t buf_entry_try_again_timeout;
 
 	/** Only populate accelerometer buffer if a configurable amount of time
 	 *  has passed since the last accelerometer buffer entry was filled.
-	 *
-	 *  If the circular buffer is filled always keep the highest
-         *  values in the circular buffer.
 	 */
-	if (k_uptime_get() - buf_entry_try_again_timeout >
+	if (k_uptime_get() - buf_entry_try_again_timeout <=
 	    1000 * CONFIG_TIME_BETWEEN_ACCELEROMETER_BUFFER_STORE_SEC) {
-		/** Populate the next available unqueued entry. */
-		for (k = 0; k < ARRAY_SIZE(accel_buf); k++) {
-			if (!accel_buf[k].queued) {
-				head_accel_buf = k;
-				goto populate_buffer;
-			}
-		}
+		return;
+	}
 
-		/** Sort list after highest values using bubble sort.
-		 */
-		for (j = 0; j < ARRAY_SIZE(accel_buf) - i - 1; j++) {
-			for (n = 0; n < 3; n++) {
-				if (temp < abs(accel_buf[j].values[n])) {
-					temp = abs(accel_buf[j].values[n]);
-				}
-
-				if (temp_ < abs(accel_buf[j + 1].values[n])) {
-					temp_ = abs(accel_buf[j + 1].values[n]);
-				}
-			}
+	if (entry_store(DATA_ACCEL, entry)) {
+		buf_entry_try_again_timeout = k_uptime_get();
+		return;
+	}
 
-			if (temp > temp_) {
-				acc_array_swap(&accel_buf[j],
-					       &accel_buf[j + 1]);
-			}
-		}
+	/** If the buffer is full always keep the highest values. The new
+	 *  entry replaces the entry with the lowest peak value, unless its
+	 *  own peak value is lower still.
+	 */
+	if (!data_heap_put(&accel_heap, entry)) {
+		return;
+	}
 
-		temp = 0;
-		temp_ = 0;
+	LOG_DBG("Accelerometer buffer: %d of %d entries queued",
+		data_ring_count(&accel_ring), CONFIG_ACCEL_BUFFER_MAX);
 
-		/** Find highest value in new accelerometer entry. */
-		for (n = 0; n < 3; n++) {
-			if (temp < abs(acc_data->value_array[n])) {
-				temp = abs(acc_data->value_array[n]);
-			}
-		}
+	buf_entry_try_again_timeout = k_uptime_get();
+}
 
-		/** Replace old accelerometer entry with the new entry if the
-		 *  highest value in new value is greater than the old.
-		 */
-		for (int k = 0; k < ARRAY_SIZE(accel_buf); k++) {
-			for (n = 0; n < 3; n++) {
-				if (temp_ < abs(accel_buf[k].values[n])) {
-					temp_ = abs(accel_buf[k].values[n]);
-				}
-
-				if (temp > temp_) {
-					head_accel_buf = k;
-				}
-			}
-		}
+/* Called from the accelerometer driver. */
+static void accel_sample_queue(const struct ext_sensor_evt *const acc_data)
+{
+	struct cloud_data_accelerometer entry = {
+		.ts = cloud_data_ts(k_uptime_get()),
+	};
 
-		// clang-format off
-populate_buffer:
-		// clang-format on
+	for (size_t i = 0; i < ARRAY_SIZE(entry.values); i++) {
+		entry.values[i] = cloud_data_fixed(acc_data->value_array[i],
+						   CLOUD_DATA_ACCEL_DECIMALS,
+						   INT16_MIN, INT16_MAX);
+	}
 
-		accel_buf[head_accel_buf].values[0] = acc_data->value_array[0];
-		accel_buf[head_accel_buf].values[1] = acc_data->value_array[1];
-		accel_buf[head_accel_buf].values[2] = acc_data->value_array[2];
-		accel_buf[head_accel_buf].ts = k_uptime_get();
-		accel_buf[head_accel_buf].queued = true;
+	if (sample_queue_put(&accel_queue, &entry)) {
+		LOG_WRN("Accelerometer sample queue full, sample dropped");
+		return;
+	}
 
-		LOG_DBG("Entry: %d of %d in accelerometer buffer filled",
-			head_accel_buf, CONFIG_ACCEL_BUFFER_MAX - 1);
+	k_work_submit_to_queue(&sample_workq, &sample_ingest_work);
+}
+#endif
 
-		buf_entry_try_again_timeout = k_uptime_get();
+static void ui_buffer_populate(struct cloud_data_ui *entry)
+{
+	entry_queue(DATA_UI, entry);
 
-		/** Always point head of buffer to the newest sampled value. */
-		for (i = 0; i < ARRAY_SIZE(accel_buf); i++) {
-			if (newest_time < accel_buf[i].ts &&
-			    accel_buf[i].queued) {
-				newest_time = accel_buf[i].ts;
-				head_accel_buf = i;
-			}
-		}
-	}
+	LOG_DBG("UI buffer: %d of %d entries queued",
+		data_ring_count(&ui_ring), CONFIG_UI_BUFFER_MAX);
 }
+
+/* Add the samples that were queued by driver callbacks and the button
+ * handler to the rings.
+ */
+static void sample_ingest_work_fn(struct k_work *work)
+{
+	struct cloud_data_gps gps;
+	struct cloud_data_ui ui;
+	bool ui_added = false;
+
+	k_mutex_lock(&data_lock, K_FOREVER);
+
+	while (!sample_queue_get(&gps_queue, &gps)) {
+		gps_buffer_populate(&gps);
+	}
+
+	while (!sample_queue_get(&ui_queue, &ui)) {
+		ui_buffer_populate(&ui);
+		ui_added = true;
+	}
+
+#if defined(CONFIG_EXTERNAL_SENSORS)
+	struct cloud_data_accelerometer accel;
+
+	while (!sample_queue_get(&accel_queue, &accel)) {
+		accelerometer_buffer_populate(&accel);
+	}
 #endif
 
+	k_mutex_unlock(&data_lock);
+
+	/* Requested by the user, sent right away. */
+	if (ui_added && cloud_connected) {
+		tx_schedule(TX_UI, true);
+	}
+}
+
 /* Produce a warning if modem firmware version is unexpected. */
 static void check_modem_fw_version(void)
 {
@@ -383,47 +937,61 @@ static void check_modem_fw_version(void)
 	modem_fw_version_checked = true;
 }
 
+/* Release the interned strings that a modem entry refers to. */
+static void modem_entry_release(const void *entry)
+{
+	const struct cloud_data_modem *modem = entry;
+
+	cloud_codec_str_release(modem->ip);
+	cloud_codec_str_release(modem->mccmnc);
+}
+
 static int modem_buffer_populate(void)
 {
 	int err;
+	struct cloud_data_modem entry;
 
 	/* Request data from modem. */
-	err = modem_info_params_get(&modem_param);
+	err = modem_info_params_get(&modem_param_read);
 	if (err) {
 		LOG_ERR("modem_info_params_get, error: %d", err);
 		return err;
 	}
 
+	/* The modem data that published identities refer to is overwritten
+	 * while the lock is held.
+	 */
+	k_mutex_lock(&data_lock, K_FOREVER);
+	modem_param = modem_param_read;
+
 	check_modem_fw_version();
 
-	/* Go to start of buffer if end is reached. */
-	head_modem_buf += 1;
-	if (head_modem_buf == CONFIG_MODEM_BUFFER_MAX) {
-		head_modem_buf = 0;
-	}
-
-	modem_buf[head_modem_buf].rsrp = rsrp_value_latest;
-	modem_buf[head_modem_buf].ip =
-		modem_param.network.ip_address.value_string;
-	modem_buf[head_modem_buf].cell = modem_param.network.cellid_dec;
-	modem_buf[head_modem_buf].mccmnc =
-		modem_param.network.current_operator.value_string;
-	modem_buf[head_modem_buf].area = modem_param.network.area_code.value;
-	modem_buf[head_modem_buf].appv = CONFIG_CAT_TRACKER_APP_VERSION;
-	modem_buf[head_modem_buf].brdv = modem_param.device.board;
-	modem_buf[head_modem_buf].fw = modem_param.device.modem_fw.value_string;
-	modem_buf[head_modem_buf].iccid = modem_param.sim.iccid.value_string;
-	modem_buf[head_modem_buf].nw_lte_m = modem_param.network.lte_mode.value;
-	modem_buf[head_modem_buf].nw_nb_iot =
-		modem_param.network.nbiot_mode.value;
-	modem_buf[head_modem_buf].nw_gps = modem_param.network.gps_mode.value;
-	modem_buf[head_modem_buf].bnd = modem_param.network.current_band.value;
-	modem_buf[head_modem_buf].mod_ts = k_uptime_get();
-	modem_buf[head_modem_buf].mod_ts_static = k_uptime_get();
-	modem_buf[head_modem_buf].queued = true;
-
-	LOG_DBG("Entry: %d of %d in modem buffer filled", head_modem_buf,
-		CONFIG_MODEM_BUFFER_MAX - 1);
+	entry.rsrp = rsrp_value_latest;
+	entry.ip = cloud_codec_str_intern(
+		modem_param.network.ip_address.value_string);
+	entry.cell = modem_param.network.cellid_dec;
+	entry.mccmnc = cloud_codec_str_intern(
+		modem_param.network.current_operator.value_string);
+	entry.area = modem_param.network.area_code.value;
+	entry.mod_ts = cloud_data_ts(k_uptime_get());
+
+	/* The strings of the identity are not changed by later samples. */
+	modem_static.appv = CONFIG_CAT_TRACKER_APP_VERSION;
+	modem_static.brdv = modem_param.device.board;
+	modem_static.fw = modem_param.device.modem_fw.value_string;
+	modem_static.iccid = modem_param.sim.iccid.value_string;
+	modem_static.nw_lte_m = modem_param.network.lte_mode.value;
+	modem_static.nw_nb_iot = modem_param.network.nbiot_mode.value;
+	modem_static.nw_gps = modem_param.network.gps_mode.value;
+	modem_static.bnd = modem_param.network.current_band.value;
+	modem_static.ts = entry.mod_ts;
+	modem_static_valid = true;
+
+	entry_queue(DATA_MODEM, &entry);
+
+	LOG_DBG("Modem buffer: %d of %d entries queued",
+		data_ring_count(&modem_ring), CONFIG_MODEM_BUFFER_MAX);
+	k_mutex_unlock(&data_lock);
 
 	return 0;
 }
@@ -432,50 +1000,56 @@ static int modem_buffer_populate(void)
 static int sensors_buffer_populate(void)
 {
 	int err;
-
-	/* Go to start of buffer if end is reached. */
-	head_sensor_buf += 1;
-	if (head_sensor_buf == CONFIG_SENSOR_BUFFER_MAX) {
-		head_sensor_buf = 0;
-	}
+	double temp;
+	double hum;
+	struct cloud_data_sensors entry;
 
 	/* Request data from external sensors. */
-	err = ext_sensors_temperature_get(&sensors_buf[head_sensor_buf].temp);
+	err = ext_sensors_temperature_get(&temp);
 	if (err) {
 		LOG_ERR("temperature_get, error: %d", err);
 		return err;
 	}
 
-	err = ext_sensors_humidity_get(&sensors_buf[head_sensor_buf].hum);
+	err = ext_sensors_humidity_get(&hum);
 	if (err) {
 		LOG_ERR("temperature_get, error: %d", err);
 		return err;
 	}
 
-	sensors_buf[head_sensor_buf].env_ts = k_uptime_get();
-	sensors_buf[head_sensor_buf].queued = true;
+	entry.temp = cloud_data_fixed(temp, CLOUD_DATA_ENV_DECIMALS,
+				      INT16_MIN, INT16_MAX);
+	entry.hum = cloud_data_fixed(hum, CLOUD_DATA_ENV_DECIMALS, 0,
+				     UINT16_MAX);
+	entry.env_ts = cloud_data_ts(k_uptime_get());
+
+	k_mutex_lock(&data_lock, K_FOREVER);
+	entry_queue(DATA_SENSORS, &entry);
 
-	LOG_DBG("Entry: %d of %d in sensor buffer filled", head_sensor_buf,
-		CONFIG_SENSOR_BUFFER_MAX - 1);
+	LOG_DBG("Sensor buffer: %d of %d entries queued",
+		data_ring_count(&sensor_ring), CONFIG_SENSOR_BUFFER_MAX);
+	k_mutex_unlock(&data_lock);
 
 	return 0;
 }
 #endif
 
-static void ui_buffer_populate(int btn_number)
+/* Called from the button handler on the system workqueue, which does not
+ * wait for the data lock.
+ */
+static void ui_sample_queue(int btn_number)
 {
-	/* Go to start of buffer if end is reached. */
-	head_ui_buf += 1;
-	if (head_ui_buf == CONFIG_UI_BUFFER_MAX) {
-		head_ui_buf = 0;
-	}
+	struct cloud_data_ui entry = {
+		.btn = 1,
+		.btn_ts = cloud_data_ts(k_uptime_get()),
+	};
 
-	ui_buf[head_ui_buf].btn = 1;
-	ui_buf[head_ui_buf].btn_ts = k_uptime_get();
-	ui_buf[head_ui_buf].queued = true;
+	if (sample_queue_put(&ui_queue, &entry)) {
+		LOG_WRN("Button sample queue full, press dropped");
+		return;
+	}
 
-	LOG_DBG("Entry: %d of %d in UI buffer filled", head_ui_buf,
-		CONFIG_UI_BUFFER_MAX - 1);
+	k_work_submit_to_queue(&sample_workq, &sample_ingest_work);
 }
 
 static void lte_evt_handler(const struct lte_lc_evt *const evt)
@@ -515,6 +1089,9 @@ static void lte_evt_handler(const struct lte_lc_evt *const evt)
 			evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ?
 				"Connected" :
 				"Idle");
+		app_event_post(evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ?
+				       APP_EVT_RRC_CONNECTED :
+				       APP_EVT_RRC_IDLE);
 		break;
 	case LTE_LC_EVT_CELL_UPDATE:
 		LOG_DBG("LTE cell changed: Cell ID: %d, Tracking area: %d",
@@ -531,8 +1108,8 @@ static void ext_sensors_evt_handler(const struct ext_sensor_evt *const evt)
 	switch (evt->type) {
 	case EXT_SENSOR_EVT_ACCELEROMETER_TRIGGER:
 		if (!cfg.act) {
-			accelerometer_buffer_populate(evt);
-			k_sem_give(&accel_trig_sem);
+			accel_sample_queue(evt);
+			app_event_post(APP_EVT_MOVEMENT);
 		}
 		break;
 	default:
@@ -573,12 +1150,22 @@ static void device_config_get(void)
 static void ui_send(void)
 {
 	int err;
-	struct cloud_codec_data codec;
+	struct cloud_codec_data codec = { .buf = codec_buf,
+					  .size = sizeof(codec_buf) };
 
 	ui_led_set_pattern(UI_CLOUD_PUBLISHING);
 
-	err = cloud_codec_encode_ui_data(&codec, &ui_buf[head_ui_buf]);
-	if (err) {
+	k_mutex_lock(&data_lock, K_FOREVER);
+	err = cloud_codec_encode_ui_data(&codec, data_ring_newest(&ui_ring));
+	if (!err) {
+		data_ring_newest_drop(&ui_ring);
+	}
+	k_mutex_unlock(&data_lock);
+
+	if (err == -EAGAIN) {
+		LOG_DBG("Button press is buffered until time is obtained");
+		return;
+	} else if (err) {
 		LOG_ERR("cloud_codec_encode_ui_data, error: %d", err);
 		return;
 	}
@@ -598,7 +1185,8 @@ static void ui_send(void)
 static void device_config_send(void)
 {
 	int err;
-	struct cloud_codec_data codec;
+	struct cloud_codec_data codec = { .buf = codec_buf,
+					  .size = sizeof(codec_buf) };
 
 	err = cloud_codec_encode_cfg_data(&codec, &cfg);
 	if (err == -EAGAIN) {
@@ -621,62 +1209,76 @@ static void device_config_send(void)
 	}
 }
 
-static void data_send(void)
+/* Log the number of entries of every type that were dropped from the buffer
+ * pool since the last buffered publication.
+ */
+static void dropped_data_log(void)
 {
-	int err;
-	struct cloud_codec_data codec;
-
-	err = cloud_codec_encode_data(
-		&codec, &gps_buf[head_gps_buf], &sensors_buf[head_sensor_buf],
-		&modem_buf[head_modem_buf], &ui_buf[head_ui_buf],
-		&accel_buf[head_accel_buf], &bat_buf[head_bat_buf]);
-	if (err) {
-		LOG_ERR("Error enconding message %d", err);
-		return;
-	}
+	uint32_t dropped;
 
-	struct cloud_msg msg = { .qos = CLOUD_QOS_AT_MOST_ONCE,
-				 .endpoint.type = CLOUD_EP_TOPIC_MSG,
-				 .buf = codec.buf,
-				 .len = codec.len };
+	for (size_t i = 0; i < ARRAY_SIZE(data_queues); i++) {
+		dropped = data_ring_dropped(data_queues[i].ring);
+		if (dropped == data_dropped_logged[i]) {
+			continue;
+		}
 
-	err = cloud_send(cloud_backend, &msg);
-	cloud_codec_release_data(&codec);
-	if (err) {
-		LOG_ERR("Cloud send failed, err: %d", err);
-		return;
+		LOG_WRN("%s buffer: %u entries dropped, %u in total",
+			data_queues[i].name, dropped - data_dropped_logged[i],
+			dropped);
+		data_dropped_logged[i] = dropped;
 	}
-	LOG_DBG("<TEST:DATA_SEND> OK");
 }
 
 static void buffered_data_send(void)
 {
 	int err;
-	bool queued_entries = false;
-	struct cloud_codec_data codec;
-
+	struct cloud_codec_data codec = { .buf = codec_buf,
+					  .size = sizeof(codec_buf) };
 	struct cloud_msg msg = {
 		.qos = CLOUD_QOS_AT_MOST_ONCE,
 		.endpoint = pub_ep_topics_sub[0],
 	};
 
-check_gps_buffer:
+	/** Only publish buffered accelerometer data if in
+	 * passive device mode.
+	 */
+	struct data_ring *accel = cfg.act ? NULL : &accel_ring;
+	size_t loaded;
 
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_GPS_BUFFER_MAX; i++) {
-		if (gps_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
+	k_mutex_lock(&data_lock, K_FOREVER);
+	dropped_data_log();
+	k_mutex_unlock(&data_lock);
+
+	/* Pack queued entries of all buffers into as few batch messages as
+	 * possible, each filled up to the size of the codec buffer.
+	 */
+	while (true) {
+		k_mutex_lock(&data_lock, K_FOREVER);
+		err = cloud_codec_encode_batch(&codec, &gps_ring, &sensor_ring,
+					       &modem_ring, &ui_ring, accel,
+					       &bat_ring);
+		if (accel != NULL) {
+			data_heap_invalidate(&accel_heap);
 		}
-	}
 
-	if (queued_entries) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_gps_buffer(&codec, gps_buf);
-		if (err) {
-			LOG_ERR("Error encoding GPS buffer: %d", err);
+		loaded = 0;
+		if (err == -ENODATA) {
+			stored_data_consume();
+			loaded = stored_data_load(accel != NULL);
+		}
+		k_mutex_unlock(&data_lock);
+
+		if (err == -ENODATA) {
+			if (loaded > 0) {
+				continue;
+			}
+
+			return;
+		} else if (err == -EAGAIN) {
+			LOG_DBG("Buffered data kept until time is obtained");
+			return;
+		} else if (err) {
+			LOG_ERR("Error encoding buffered data: %d", err);
 			return;
 		}
 
@@ -687,178 +1289,290 @@ check_gps_buffer:
 		cloud_codec_release_data(&codec);
 		if (err) {
 			LOG_ERR("Cloud send failed, err: %d", err);
+			stored_data_rewind();
 			return;
 		}
+	}
+}
 
-		goto check_gps_buffer;
+/* Copy an entry into a snapshot. Returns the copy, or NULL if there is no
+ * entry.
+ */
+static void *snapshot_entry_copy(void *copy, const void *entry, size_t size)
+{
+	if (entry == NULL) {
+		return NULL;
 	}
 
-check_sensors_buffer:
+	memcpy(copy, entry, size);
 
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_SENSOR_BUFFER_MAX; i++) {
-		if (sensors_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
-		}
+	return copy;
+}
+
+/* Sample stage. Take a snapshot of the newest entries. The entries are left
+ * in the rings until the snapshot is encoded, UI entries are published on
+ * their own or with the buffered data. Called with the data lock held.
+ * Returns NULL if all snapshots are in use, the entries are then published
+ * with the buffered data.
+ */
+static struct snapshot *snapshot_take(uint32_t cycle)
+{
+	struct snapshot *snap;
+
+	if (k_msgq_get(&snapshot_free_msgq, &snap, K_NO_WAIT)) {
+		LOG_WRN("No free snapshot, newest data left in the buffers");
+		return NULL;
+	}
+
+	snap->cycle = cycle;
+
+	snap->gps = snapshot_entry_copy(&snap->gps_entry,
+					data_ring_newest(&gps_ring),
+					sizeof(snap->gps_entry));
+	snap->sensors = snapshot_entry_copy(&snap->sensors_entry,
+					    data_ring_newest(&sensor_ring),
+					    sizeof(snap->sensors_entry));
+	snap->modem = snapshot_entry_copy(&snap->modem_entry,
+					  data_ring_newest(&modem_ring),
+					  sizeof(snap->modem_entry));
+	if (snap->modem != NULL) {
+		/* The ring entry can be evicted before the copy is encoded. */
+		cloud_codec_str_retain(snap->modem->ip);
+		cloud_codec_str_retain(snap->modem->mccmnc);
+	}
+	snap->modem_static = snapshot_entry_copy(
+		&snap->modem_static_entry,
+		modem_static_valid ? &modem_static : NULL,
+		sizeof(snap->modem_static_entry));
+	snap->accel = snapshot_entry_copy(&snap->accel_entry,
+					  data_heap_newest(&accel_heap),
+					  sizeof(snap->accel_entry));
+	snap->bat = snapshot_entry_copy(&snap->bat_entry,
+					data_ring_newest(&bat_ring),
+					sizeof(snap->bat_entry));
+
+	return snap;
+}
+
+/* Drop the entry of a ring that a snapshot was taken from. Entries may have
+ * been added or published with the buffered data since, so the entry is
+ * looked up from the newest one on. The order of the other entries is kept.
+ * Called with the data lock held.
+ */
+static void snapshot_entry_drop(struct data_ring *ring, const void *entry)
+{
+	size_t count = data_ring_count(ring);
+
+	if (entry == NULL) {
+		return;
 	}
 
-	if (queued_entries) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_sensor_buffer(&codec, sensors_buf);
-		if (err) {
-			LOG_ERR("Error encoding sensors buffer: %d", err);
-			return;
+	for (size_t i = count; i-- > 0;) {
+		if (memcmp(data_ring_get(ring, i), entry, ring->entry_size)) {
+			continue;
 		}
 
-		msg.buf = codec.buf;
-		msg.len = codec.len;
-
-		err = cloud_send(cloud_backend, &msg);
-		cloud_codec_release_data(&codec);
-		if (err) {
-			LOG_ERR("Cloud send failed, err: %d", err);
-			return;
+		for (; i + 1 < count; i++) {
+			data_ring_swap(ring, i, i + 1);
 		}
 
-		goto check_sensors_buffer;
+		data_ring_newest_drop(ring);
+		return;
 	}
+}
 
-check_modem_buffer:
+/* Drop the entries of an encoded snapshot from the rings, they are published
+ * with it. Called with the data lock held.
+ */
+static void snapshot_entries_drop(const struct snapshot *snap)
+{
+	snapshot_entry_drop(&gps_ring, snap->gps);
+	snapshot_entry_drop(&sensor_ring, snap->sensors);
+	snapshot_entry_drop(&modem_ring, snap->modem);
+	snapshot_entry_drop(&bat_ring, snap->bat);
 
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_MODEM_BUFFER_MAX; i++) {
-		if (modem_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
-		}
+	if (snap->accel != NULL) {
+		snapshot_entry_drop(&accel_ring, snap->accel);
+		data_heap_invalidate(&accel_heap);
 	}
+}
 
-	if (queued_entries) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_modem_buffer(&codec, modem_buf);
-		if (err) {
-			LOG_ERR("Error encoding modem buffer: %d", err);
-			return;
+/* Encode stage, runs on the publishing workqueue. The entries of a snapshot
+ * are only dropped from the rings once it is encoded, or if they have
+ * nothing to report since they were already reported. If encoding fails, for
+ * instance while the time is unknown, they are kept and published with the
+ * buffered data.
+ */
+static void snapshot_encode_work_fn(struct k_work *work)
+{
+	int err;
+	struct snapshot *snap;
+
+	while (!k_msgq_get(&snapshot_encode_msgq, &snap, K_NO_WAIT)) {
+		snap->codec = (struct cloud_codec_data){
+			.buf = snap->buf,
+			.size = sizeof(snap->buf),
+		};
+
+		k_mutex_lock(&data_lock, K_FOREVER);
+		err = cloud_codec_encode_data(&snap->codec, &snap->report,
+					      snap->gps, snap->sensors,
+					      snap->modem, snap->modem_static,
+					      NULL, snap->accel, snap->bat);
+		if (!err || (err == -ENODATA)) {
+			snapshot_entries_drop(snap);
 		}
 
-		msg.buf = codec.buf;
-		msg.len = codec.len;
+		if (snap->modem != NULL) {
+			modem_entry_release(snap->modem);
+		}
+		k_mutex_unlock(&data_lock);
+
+		if (err == -ENODATA) {
+			LOG_DBG("No changed data to send");
+		} else if (err == -EAGAIN) {
+			LOG_DBG("Data kept until time is obtained");
+		} else if (err) {
+			LOG_ERR("Error enconding message %d", err);
+		}
 
-		err = cloud_send(cloud_backend, &msg);
-		cloud_codec_release_data(&codec);
 		if (err) {
-			LOG_ERR("Cloud send failed, err: %d", err);
-			return;
+			cloud_codec_release_data(&snap->codec);
 		}
 
-		goto check_modem_buffer;
-	}
-
-check_ui_buffer:
-
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_UI_BUFFER_MAX; i++) {
-		if (ui_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
-		}
+		k_msgq_put(&snapshot_send_msgq, &snap, K_NO_WAIT);
+		k_work_submit_to_queue(&send_workq, &snapshot_send_work);
 	}
+}
 
-	if (queued_entries) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_ui_buffer(&codec, ui_buf);
-		if (err) {
-			LOG_ERR("Error encoding modem buffer: %d", err);
-			return;
+/* Send stage, runs on the publishing workqueue. */
+static void snapshot_send_work_fn(struct k_work *work)
+{
+	int err;
+	struct snapshot *snap;
+
+	while (!k_msgq_get(&snapshot_send_msgq, &snap, K_NO_WAIT)) {
+		if (snap->codec.len > 0) {
+			struct cloud_msg msg = {
+				.qos = CLOUD_QOS_AT_MOST_ONCE,
+				.endpoint.type = CLOUD_EP_TOPIC_MSG,
+				.buf = snap->codec.buf,
+				.len = snap->codec.len
+			};
+
+			err = cloud_send(cloud_backend, &msg);
+			cloud_codec_release_data(&snap->codec);
+			if (err) {
+				LOG_ERR("Cloud send failed, err: %d", err);
+			} else {
+				/* Values that were not published are
+				 * reported again with the next message.
+				 */
+				k_mutex_lock(&data_lock, K_FOREVER);
+				cloud_codec_report_commit(&snap->report);
+				k_mutex_unlock(&data_lock);
+				LOG_DBG("<TEST:DATA_SEND> OK");
+			}
 		}
 
-		msg.buf = codec.buf;
-		msg.len = codec.len;
+		buffered_data_send();
 
-		err = cloud_send(cloud_backend, &msg);
-		cloud_codec_release_data(&codec);
-		if (err) {
-			LOG_ERR("Cloud send failed, err: %d", err);
-			return;
+		if (snap->cycle) {
+			cycle_event_post(APP_EVT_PUBLISHED, snap->cycle);
 		}
 
-		goto check_ui_buffer;
+		k_msgq_put(&snapshot_free_msgq, &snap, K_NO_WAIT);
 	}
+}
 
-check_accel_buffer:
+static struct k_delayed_work *tx_work_get(enum tx_msg msg)
+{
+	switch (msg) {
+	case TX_CFG_GET:
+		return &device_config_get_work;
+	case TX_CFG_SEND:
+		return &device_config_send_work;
+	case TX_BUFFERED:
+		return &buffered_data_send_work;
+	case TX_UI:
+		return &ui_send_work;
+	default:
+		return NULL;
+	}
+}
 
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_ACCEL_BUFFER_MAX; i++) {
-		if (accel_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
-		}
+/* Queue a message on the publishing workqueue, or hold it until the next
+ * radio window unless it is urgent.
+ */
+static void tx_schedule(enum tx_msg msg, bool urgent)
+{
+	if (!urgent && !atomic_get(&rrc_connected)) {
+		LOG_DBG("Message %d held until the next radio window", msg);
+		atomic_set_bit(&tx_held, msg);
+		return;
 	}
 
-	/** Only publish buffered accelerometer data if in
-	 * passive device mode.
-	 */
-	if (queued_entries && !cfg.act) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_accel_buffer(&codec, accel_buf);
-		if (err) {
-			LOG_ERR("Error encoding accelerometer buffer: %d", err);
-			return;
-		}
+	atomic_clear_bit(&tx_held, msg);
+	k_delayed_work_submit_to_queue(&send_workq, tx_work_get(msg),
+				       K_NO_WAIT);
+}
 
-		msg.buf = codec.buf;
-		msg.len = codec.len;
+/* Queue all held messages, they are sent back-to-back. */
+static void tx_flush(void)
+{
+	atomic_val_t held = atomic_clear(&tx_held);
 
-		err = cloud_send(cloud_backend, &msg);
-		cloud_codec_release_data(&codec);
-		if (err) {
-			LOG_ERR("Cloud send failed, err: %d", err);
-			return;
+	for (enum tx_msg msg = TX_CFG_GET; msg <= TX_UI; msg++) {
+		if (held & BIT(msg)) {
+			k_delayed_work_submit_to_queue(&send_workq,
+						       tx_work_get(msg),
+						       K_NO_WAIT);
 		}
-
-		goto check_accel_buffer;
 	}
+}
 
-check_battery_buffer:
+/* Hand the publications that waited for the data sample over to the
+ * publishing workqueue. The newest entries go through the encode stage first
+ * if a snapshot of them was taken.
+ */
+static void publish_pending_submit(atomic_val_t pending, uint32_t cycle,
+				   struct snapshot *snap)
+{
+	if (pending & PUBLISH_CYCLE) {
+		cycle_event_post(APP_EVT_SAMPLED, cycle);
+	}
 
-	/* Check if it exists queued entries in the gps buffer. */
-	for (int i = 0; i < CONFIG_BAT_BUFFER_MAX; i++) {
-		if (bat_buf[i].queued) {
-			queued_entries = true;
-			break;
-		} else {
-			queued_entries = false;
+	if (!cloud_connected && (snap == NULL)) {
+		LOG_INF("Not connected to cloud!");
+		if (pending & PUBLISH_CYCLE) {
+			cycle_event_post(APP_EVT_PUBLISHED, cycle);
 		}
+		return;
 	}
 
-	if (queued_entries) {
-		/* Encode and send queued entries in batches. */
-		err = cloud_codec_encode_bat_buffer(&codec, bat_buf);
-		if (err) {
-			LOG_ERR("Error encoding accelerometer buffer: %d", err);
-			return;
-		}
+	/* A publication of the cycle opens the planned radio window. */
+	if (pending & PUBLISH_CYCLE) {
+		tx_flush();
+	}
 
-		msg.buf = codec.buf;
-		msg.len = codec.len;
+	/* The configuration is exchanged when the cloud connection is set
+	 * up, the radio is on anyway.
+	 */
+	if (pending & PUBLISH_CFG) {
+		tx_schedule(TX_CFG_GET, true);
+		tx_schedule(TX_CFG_SEND, true);
+	}
 
-		err = cloud_send(cloud_backend, &msg);
-		cloud_codec_release_data(&codec);
-		if (err) {
-			LOG_ERR("Cloud send failed, err: %d", err);
-			return;
-		}
+	if (snap != NULL) {
+		k_msgq_put(&snapshot_encode_msgq, &snap, K_NO_WAIT);
+		k_work_submit_to_queue(&send_workq, &snapshot_encode_work);
+		return;
+	}
+
+	tx_schedule(TX_BUFFERED, pending & PUBLISH_CYCLE);
 
-		goto check_battery_buffer;
+	if (pending & PUBLISH_CYCLE) {
+		cycle_event_post(APP_EVT_PUBLISHED, cycle);
 	}
 }
 
@@ -869,16 +1583,9 @@ static void config_get(void)
 	/** Sample data from modem and environmental sensor before
 	 *  cloud publication.
 	 */
-	k_delayed_work_submit(&sample_data_work, K_NO_WAIT);
-
-	if (cloud_connected) {
-		k_delayed_work_submit(&device_config_get_work, K_NO_WAIT);
-		k_delayed_work_submit(&device_config_send_work, K_NO_WAIT);
-		k_delayed_work_submit(&data_send_work, K_NO_WAIT);
-		k_delayed_work_submit(&buffered_data_send_work, K_NO_WAIT);
-	} else {
-		LOG_INF("Not connected to cloud!");
-	}
+	atomic_or(&publish_pending, PUBLISH_CFG | PUBLISH_DATA);
+	k_delayed_work_submit_to_queue(&sample_workq, &sample_data_work,
+				       K_NO_WAIT);
 }
 
 static void data_publish(void)
@@ -888,14 +1595,10 @@ static void data_publish(void)
 	/** Sample data from modem and environmental sensor before
 	 *  cloud publication.
 	 */
-	k_delayed_work_submit(&sample_data_work, K_NO_WAIT);
-
-	if (cloud_connected) {
-		k_delayed_work_submit(&data_send_work, K_NO_WAIT);
-		k_delayed_work_submit(&buffered_data_send_work, K_NO_WAIT);
-	} else {
-		LOG_INF("Not connected to cloud!");
-	}
+	atomic_set(&publish_cycle, cycle_id);
+	atomic_or(&publish_pending, PUBLISH_DATA | PUBLISH_CYCLE);
+	k_delayed_work_submit_to_queue(&sample_workq, &sample_data_work,
+				       K_NO_WAIT);
 }
 
 static void cloud_connect_work_fn(struct k_work *work)
@@ -912,11 +1615,11 @@ static void cloud_connect_work_fn(struct k_work *work)
 		CLOUD_RECONNECTION_INTERVAL);
 
 	/* Try to reconnect to cloud every 30 seconds. */
-	k_delayed_work_submit(&cloud_connect_work,
-			      K_SECONDS(CLOUD_RECONNECTION_INTERVAL));
+	k_delayed_work_submit_to_queue(&connection_workq, &cloud_connect_work,
+				       K_SECONDS(CLOUD_RECONNECTION_INTERVAL));
 }
 
-static void sample_data_work_fn(struct k_work *work)
+static void data_sample(void)
 {
 	int err;
 
@@ -937,6 +1640,32 @@ static void sample_data_work_fn(struct k_work *work)
 #endif
 }
 
+static void sample_data_work_fn(struct k_work *work)
+{
+	atomic_val_t pending = atomic_clear(&publish_pending);
+	uint32_t cycle = 0;
+	struct snapshot *snap = NULL;
+
+	if (pending & PUBLISH_CYCLE) {
+		cycle = atomic_get(&publish_cycle);
+	}
+
+	/* The modem and the sensors are read without the data lock held,
+	 * it is only taken to add the entries and take the snapshot.
+	 */
+	data_sample();
+
+	if ((pending & PUBLISH_DATA) && cloud_connected) {
+		k_mutex_lock(&data_lock, K_FOREVER);
+		snap = snapshot_take(cycle);
+		k_mutex_unlock(&data_lock);
+	}
+
+	if (pending != 0) {
+		publish_pending_submit(pending, cycle, snap);
+	}
+}
+
 static void leds_set_work_fn(struct k_work *work)
 {
 	leds_set();
@@ -952,11 +1681,6 @@ static void device_config_send_work_fn(struct k_work *work)
 	device_config_send();
 }
 
-static void data_send_work_fn(struct k_work *work)
-{
-	data_send();
-}
-
 static void buffered_data_send_work_fn(struct k_work *work)
 {
 	buffered_data_send();
@@ -971,16 +1695,29 @@ static void mov_timeout_work_fn(struct k_work *work)
 {
 	if (!cfg.act) {
 		LOG_INF("Movement timeout triggered");
-		k_sem_give(&accel_trig_sem);
+		app_event_post(APP_EVT_MOVEMENT);
 	}
 
-	k_delayed_work_submit(&mov_timeout_work, K_SECONDS(cfg.movt));
+	k_delayed_work_submit_to_queue(&sample_workq, &mov_timeout_work,
+				       K_SECONDS(cfg.movt));
 }
 
 static void work_init(void)
 {
+	k_work_q_start(&sample_workq, sample_workq_stack,
+		       K_THREAD_STACK_SIZEOF(sample_workq_stack),
+		       CONFIG_SAMPLE_WORKQUEUE_PRIORITY);
+	k_thread_name_set(&sample_workq.thread, "sample_workq");
+	k_work_q_start(&send_workq, send_workq_stack,
+		       K_THREAD_STACK_SIZEOF(send_workq_stack),
+		       CONFIG_SEND_WORKQUEUE_PRIORITY);
+	k_thread_name_set(&send_workq.thread, "send_workq");
+	k_work_q_start(&connection_workq, connection_workq_stack,
+		       K_THREAD_STACK_SIZEOF(connection_workq_stack),
+		       CONFIG_CONNECTION_WORKQUEUE_PRIORITY);
+	k_thread_name_set(&connection_workq.thread, "connection_workq");
+
 	k_delayed_work_init(&device_config_get_work, device_config_get_work_fn);
-	k_delayed_work_init(&data_send_work, data_send_work_fn);
 	k_delayed_work_init(&device_config_send_work,
 			    device_config_send_work_fn);
 	k_delayed_work_init(&buffered_data_send_work,
@@ -990,6 +1727,18 @@ static void work_init(void)
 	k_delayed_work_init(&ui_send_work, ui_send_work_fn);
 	k_delayed_work_init(&sample_data_work, sample_data_work_fn);
 	k_delayed_work_init(&cloud_connect_work, cloud_connect_work_fn);
+	k_work_init(&sample_ingest_work, sample_ingest_work_fn);
+	k_work_init(&snapshot_encode_work, snapshot_encode_work_fn);
+	k_work_init(&snapshot_send_work, snapshot_send_work_fn);
+#if defined(CONFIG_DATA_STORE)
+	k_work_init(&store_work, store_work_fn);
+#endif
+
+	for (size_t i = 0; i < ARRAY_SIZE(snapshots); i++) {
+		struct snapshot *snap = &snapshots[i];
+
+		k_msgq_put(&snapshot_free_msgq, &snap, K_NO_WAIT);
+	}
 }
 
 static void gps_trigger_handler(const struct device *dev, struct gps_event *evt)
@@ -1003,7 +1752,7 @@ static void gps_trigger_handler(const struct device *dev, struct gps_event *evt)
 		break;
 	case GPS_EVT_SEARCH_TIMEOUT:
 		LOG_INF("GPS_EVT_SEARCH_TIMEOUT");
-		k_sem_give(&gps_timeout_sem);
+		app_event_post(APP_EVT_GPS);
 		break;
 	case GPS_EVT_PVT:
 		/* Don't spam logs */
@@ -1011,9 +1760,9 @@ static void gps_trigger_handler(const struct device *dev, struct gps_event *evt)
 	case GPS_EVT_PVT_FIX:
 		LOG_INF("GPS_EVT_PVT_FIX");
 		gps_time_set(&evt->pvt);
-		gps_buffer_populate(&evt->pvt);
+		gps_sample_queue(&evt->pvt);
 		gps_fix = true;
-		k_sem_give(&gps_timeout_sem);
+		app_event_post(APP_EVT_GPS);
 		break;
 	case GPS_EVT_NMEA:
 		/* Don't spam logs */
@@ -1054,9 +1803,11 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	case CLOUD_EVT_CONNECTED:
 		LOG_INF("CLOUD_EVT_CONNECTED");
 		cloud_connected = true;
-		config_get();
+		k_mutex_lock(&data_lock, K_FOREVER);
+		cloud_codec_session_reset();
+		k_mutex_unlock(&data_lock);
 		boot_write_img_confirmed();
-		k_delayed_work_cancel(&cloud_connect_work);
+		app_event_post(APP_EVT_CLOUD_CONNECTED);
 		break;
 	case CLOUD_EVT_READY:
 		LOG_INF("CLOUD_EVT_READY");
@@ -1070,7 +1821,7 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 	case CLOUD_EVT_DISCONNECTED:
 		LOG_INF("CLOUD_EVT_DISCONNECTED");
 		cloud_connected = false;
-		k_delayed_work_submit(&cloud_connect_work, K_NO_WAIT);
+		app_event_post(APP_EVT_CLOUD_DISCONNECTED);
 		break;
 	case CLOUD_EVT_ERROR:
 		LOG_ERR("CLOUD_EVT_ERROR");
@@ -1094,14 +1845,16 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 		break;
 	case CLOUD_EVT_DATA_RECEIVED:
 		LOG_DBG("CLOUD_EVT_DATA_RECEIVED");
-		err = cloud_codec_decode_response(evt->data.msg.buf, &cfg);
+		err = cloud_codec_decode_response(evt->data.msg.buf,
+						  evt->data.msg.len, &cfg);
 		if (err) {
 			LOG_ERR("Could not decode response %d", err);
 		}
 		/* Set new accelerometer threshold and GPS timeout. */
 		gps_cfg.timeout = cfg.gpst;
 		ext_sensors_mov_thres_set(cfg.acct);
-		k_delayed_work_submit(&device_config_send_work, K_NO_WAIT);
+		tx_schedule(TX_CFG_SEND, false);
+		app_event_post(APP_EVT_CONFIG);
 
 		/* Start movement timer which triggers every movement timeout.
 		 * Makes sure the device publishes every once and a while even
@@ -1113,8 +1866,9 @@ void cloud_event_handler(const struct cloud_backend *const backend,
 		if (cfg.movt != mov_timeout_prev) {
 			LOG_INF("Schedueling movement timeout in %d seconds",
 				cfg.movt);
-			k_delayed_work_submit(&mov_timeout_work,
-					      K_SECONDS(cfg.movt));
+			k_delayed_work_submit_to_queue(&sample_workq,
+						       &mov_timeout_work,
+						       K_SECONDS(cfg.movt));
 			mov_timeout_prev = cfg.movt;
 		}
 
@@ -1169,6 +1923,12 @@ static int modem_data_init(void)
 		return err;
 	}
 
+	err = modem_info_params_init(&modem_param_read);
+	if (err) {
+		LOG_INF("modem_info_params_init, error: %d", err);
+		return err;
+	}
+
 	err = modem_info_rsrp_register(modem_rsrp_handler);
 	if (err) {
 		LOG_INF("modem_info_rsrp_register, error: %d", err);
@@ -1191,10 +1951,9 @@ static void button_handler(uint32_t button_states, uint32_t has_changed)
 		LOG_INF("2 seconds to next allowed cloud publication ");
 		LOG_INF("triggered by button 1");
 
-		ui_buffer_populate(1);
+		ui_sample_queue(1);
 
 		if (cloud_connected) {
-			k_delayed_work_submit(&ui_send_work, K_NO_WAIT);
 			k_delayed_work_submit(&leds_set_work, K_SECONDS(3));
 		} else {
 			LOG_INF("Not connected to cloud!");
@@ -1208,7 +1967,7 @@ static void button_handler(uint32_t button_states, uint32_t has_changed)
 	 * default. Reset accelerometer data.
 	 */
 	if (has_changed & button_states & DK_BTN2_MSK) {
-		k_sem_give(&accel_trig_sem);
+		app_event_post(APP_EVT_MOVEMENT);
 	}
 #endif
 }
@@ -1340,6 +2099,238 @@ static int gps_setup(void)
 	return 0;
 }
 
+static const char *app_state_name(enum app_state state)
+{
+	switch (state) {
+	case STATE_IDLE:
+		return "IDLE";
+	case STATE_GPS_SEARCH:
+		return "GPS_SEARCH";
+	case STATE_SAMPLING:
+		return "SAMPLING";
+	case STATE_PUBLISHING:
+		return "PUBLISHING";
+	case STATE_SLEEPING:
+		return "SLEEPING";
+	default:
+		return "Unknown";
+	}
+}
+
+static void app_state_set(enum app_state state)
+{
+	LOG_DBG("State: %s -> %s", app_state_name(app_state),
+		app_state_name(state));
+	app_state = state;
+}
+
+static void sampling_start(void)
+{
+	int err;
+
+	err = gps_stop(gps_dev);
+	if (err) {
+		LOG_ERR("Failed to stop GPS, error: %d", err);
+		error_handler(err);
+	}
+
+	app_state_set(STATE_SAMPLING);
+
+	/*Send update to cloud. */
+	data_publish();
+}
+
+static void rrc_mode_set(bool connected)
+{
+	int64_t now = k_uptime_get();
+
+	if (atomic_set(&rrc_connected, connected) == connected) {
+		return;
+	}
+
+	if (connected) {
+		rrc_connected_start = now;
+	} else {
+		rrc_connected_ms += now - rrc_connected_start;
+	}
+}
+
+/* Log the time the modem spent in RRC connected mode since the last report. */
+static void rrc_connected_time_report(void)
+{
+	int64_t now = k_uptime_get();
+
+	if (atomic_get(&rrc_connected)) {
+		rrc_connected_ms += now - rrc_connected_start;
+		rrc_connected_start = now;
+	}
+
+	LOG_INF("Radio connected for %d ms during the last cycle",
+		(int)rrc_connected_ms);
+	rrc_connected_ms = 0;
+}
+
+static void cycle_start(void)
+{
+	int err;
+
+	rrc_connected_time_report();
+	movement_pending = false;
+	cycle_id++;
+	sleep_timer_stop();
+
+	/** Start GPS search, disable GPS if gpst is set to 0. */
+	if (cfg.gpst == 0) {
+		sampling_start();
+		return;
+	}
+
+	err = gps_start(gps_dev, &gps_cfg);
+	if (err) {
+		LOG_ERR("Failed to enable GPS, error: %d", err);
+		error_handler(err);
+	}
+
+	app_state_set(STATE_GPS_SEARCH);
+	k_delayed_work_submit(&leds_set_work, K_NO_WAIT);
+}
+
+static void idle_start(void)
+{
+	LOG_INF("Device in PASSIVE mode");
+	app_state_set(STATE_IDLE);
+	k_delayed_work_submit(&leds_set_work, K_NO_WAIT);
+}
+
+/* Start the next cycle, or wait for movement in passive mode. */
+static void cycle_next(void)
+{
+	if (cfg.act) {
+		LOG_INF("Device in ACTIVE mode");
+		cycle_start();
+	} else if (movement_pending) {
+		LOG_INF("Device in PASSIVE mode, movement detected");
+		cycle_start();
+	} else {
+		idle_start();
+	}
+}
+
+/* Schedule the end of the sleep that started at sleep_start, for the
+ * interval of the current device mode.
+ */
+static void sleep_schedule(void)
+{
+	int64_t remaining = sleep_start +
+			    (int64_t)device_mode_check() * MSEC_PER_SEC -
+			    k_uptime_get();
+
+	sleep_timer_stop();
+
+	if (remaining <= 0) {
+		cycle_next();
+		return;
+	}
+
+	k_timer_start(&sleep_timer, K_MSEC(remaining), K_NO_WAIT);
+}
+
+static void config_apply(void)
+{
+	switch (app_state) {
+	case STATE_IDLE:
+		if (cfg.act) {
+			cycle_next();
+		}
+		break;
+	case STATE_GPS_SEARCH:
+		if (cfg.gpst == 0) {
+			sampling_start();
+		}
+		break;
+	case STATE_PUBLISHING:
+	case STATE_SLEEPING:
+		sleep_schedule();
+		break;
+	default:
+		/* Applied when the sleep starts. */
+		break;
+	}
+
+	k_delayed_work_submit(&leds_set_work, K_NO_WAIT);
+}
+
+static void app_event_handle(enum app_event evt)
+{
+	switch (evt) {
+	case APP_EVT_MOVEMENT:
+		if (app_state == STATE_IDLE) {
+			LOG_INF("The cat is moving!");
+			LOG_INF("Or it's lazy and this is just the movement "
+				"timeout!");
+			cycle_start();
+		} else {
+			movement_pending = true;
+		}
+		break;
+	case APP_EVT_TIMER:
+		if ((app_state == STATE_PUBLISHING) ||
+		    (app_state == STATE_SLEEPING)) {
+			cycle_next();
+		}
+		break;
+	case APP_EVT_GPS:
+		if (app_state == STATE_GPS_SEARCH) {
+			sampling_start();
+		}
+		break;
+	case APP_EVT_CONFIG:
+		config_apply();
+		break;
+	case APP_EVT_CLOUD_CONNECTED:
+		k_delayed_work_cancel(&cloud_connect_work);
+		config_get();
+		break;
+	case APP_EVT_CLOUD_DISCONNECTED:
+		k_delayed_work_submit_to_queue(&connection_workq,
+					       &cloud_connect_work, K_NO_WAIT);
+		break;
+	case APP_EVT_SAMPLED:
+		if ((app_state != STATE_SAMPLING) ||
+		    ((uint32_t)atomic_get(&cycle_sampled) != cycle_id)) {
+			break;
+		}
+
+		app_state_set(STATE_PUBLISHING);
+		sleep_start = k_uptime_get();
+		sleep_schedule();
+
+		/* Set device mode led behaviour */
+		k_delayed_work_submit(&leds_set_work, K_SECONDS(15));
+
+		LOG_INF("Going to sleep for: %d seconds", device_mode_check());
+		break;
+	case APP_EVT_PUBLISHED:
+		/* The publication of the previous cycle can be sent after
+		 * the next cycle has started.
+		 */
+		if ((app_state == STATE_PUBLISHING) &&
+		    ((uint32_t)atomic_get(&cycle_published) == cycle_id)) {
+			app_state_set(STATE_SLEEPING);
+		}
+		break;
+	case APP_EVT_RRC_CONNECTED:
+		rrc_mode_set(true);
+		tx_flush();
+		break;
+	case APP_EVT_RRC_IDLE:
+		rrc_mode_set(false);
+		break;
+	default:
+		break;
+	}
+}
+
 void main(void)
 {
 	int err;
@@ -1352,8 +2343,26 @@ void main(void)
 	}
 #endif
 
+	data_pool_init(&data_pool);
+	modem_ring.release = modem_entry_release;
+
+	for (size_t i = 0; i < ARRAY_SIZE(data_queues); i++) {
+		err = data_pool_ring_add(data_queues[i].ring);
+		if (err) {
+			LOG_ERR("data_pool_ring_add, error: %d", err);
+			error_handler(err);
+		}
+	}
+
 	work_init();
 
+#if defined(CONFIG_DATA_STORE)
+	err = data_store_init();
+	if (err) {
+		LOG_ERR("data_store_init, error: %d", err);
+	}
+#endif
+
 #if defined(CONFIG_EXTERNAL_SENSORS)
 	err = ext_sensors_init(ext_sensors_evt_handler);
 	if (err) {
@@ -1415,47 +2424,28 @@ void main(void)
 			DATE_TIME_TIMEOUT_S);
 	}
 
-	k_delayed_work_submit(&cloud_connect_work, K_NO_WAIT);
+	k_delayed_work_submit_to_queue(&connection_workq, &cloud_connect_work,
+				       K_NO_WAIT);
+
+	cycle_next();
 
 	while (true) {
-		/*Check current device mode*/
-		if (!cfg.act) {
-			LOG_INF("Device in PASSIVE mode");
-			k_delayed_work_submit(&leds_set_work, K_NO_WAIT);
-			if (!k_sem_take(&accel_trig_sem, K_FOREVER)) {
-				LOG_INF("The cat is moving!");
-				LOG_INF("Or it's lazy and this is just the movement timeout!");
-			}
-		} else {
-			LOG_INF("Device in ACTIVE mode");
-		}
+		enum app_event evt;
 
-		/** Start GPS search, disable GPS if gpst is set to 0. */
-		if (cfg.gpst > 0) {
-			gps_start(gps_dev, &gps_cfg);
-			if (err) {
-				LOG_ERR("Failed to enable GPS, error: %d", err);
-				error_handler(err);
-			}
+		k_msgq_get(&app_msgq, &evt, K_FOREVER);
 
-			/*Wait for GPS search timeout*/
-			k_sem_take(&gps_timeout_sem, K_FOREVER);
+		if (!(BIT(evt) & APP_EVT_LOSSLESS)) {
+			app_event_handle(evt);
 		}
 
-		err = gps_stop(gps_dev);
-		if (err) {
-			LOG_ERR("Failed to stop GPS, error: %d", err);
-			error_handler(err);
+		/* In the order of enum app_event, a cycle is sampled before
+		 * it is published.
+		 */
+		for (evt = 0; evt <= APP_EVT_RRC_IDLE; evt++) {
+			if ((BIT(evt) & APP_EVT_LOSSLESS) &&
+			    atomic_test_and_clear_bit(&app_evt_pending, evt)) {
+				app_event_handle(evt);
+			}
 		}
-
-		/*Send update to cloud. */
-		data_publish();
-
-		/* Set device mode led behaviour */
-		k_delayed_work_submit(&leds_set_work, K_SECONDS(15));
-
-		/*Sleep*/
-		LOG_INF("Going to sleep for: %d seconds", device_mode_check());
-		k_sleep(K_SECONDS(device_mode_check()));
 	}
 }
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <string.h>
+#include <errno.h>
+#include "sample_queue.h"
+
+static uint8_t *record_at(const struct sample_queue *queue, uint32_t count)
+{
+	return queue->buf + (count % queue->size) * queue->record_size;
+}
+
+int sample_queue_put(struct sample_queue *queue, const void *record)
+{
+	uint32_t head = (uint32_t)atomic_get(&queue->head);
+	uint32_t tail = (uint32_t)atomic_get(&queue->tail);
+
+	if (head - tail >= queue->size) {
+		return -ENOMEM;
+	}
+
+	memcpy(record_at(queue, head), record, queue->record_size);
+
+	/* Publish the record only once it has been written. */
+	atomic_set(&queue->head, (atomic_val_t)(head + 1));
+
+	return 0;
+}
+
+int sample_queue_get(struct sample_queue *queue, void *record)
+{
+	uint32_t tail = (uint32_t)atomic_get(&queue->tail);
+	uint32_t head = (uint32_t)atomic_get(&queue->head);
+
+	if (head == tail) {
+		return -ENODATA;
+	}
+
+	memcpy(record, record_at(queue, tail), queue->record_size);
+
+	/* Release the slot only once the record has been read. */
+	atomic_set(&queue->tail, (atomic_val_t)(tail + 1));
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Lock-free queue of sampled data records.
+ */
+
+#ifndef SAMPLE_QUEUE_H__
+#define SAMPLE_QUEUE_H__
+
+#include <zephyr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/atomic.h>
+
+/**@file
+ *
+ * @defgroup sample_queue Sample queue
+ * @brief    Queue that hands over records of a fixed size from one producer
+ *	     context to one consumer context.
+ *
+ * The producer and the consumer each own one of the two indexes of the queue
+ * and only read the other one, so no lock is needed as long as there is at
+ * most one producer and one consumer at a time. The producer can run in an
+ * interrupt or a driver callback. Both operations copy one record and run in
+ * constant time.
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct sample_queue {
+	/** Storage of the records. */
+	uint8_t *buf;
+	/** Size of one record. */
+	size_t record_size;
+	/** Maximum number of records. */
+	size_t size;
+	/** Number of records ever added, written by the producer. */
+	atomic_t head;
+	/** Number of records ever taken, written by the consumer. */
+	atomic_t tail;
+};
+
+/**
+ * @brief Statically define and initialize a queue of records of a type.
+ *
+ * @param _name Name of the queue.
+ * @param _type Type of the records.
+ * @param _size Maximum number of records, a power of two.
+ */
+#define SAMPLE_QUEUE_DEFINE(_name, _type, _size)                               \
+	BUILD_ASSERT(((_size) & ((_size) - 1)) == 0);                          \
+	static _type _name##_records[_size];                                   \
+	static struct sample_queue _name = {                                   \
+		.buf = (uint8_t *)_name##_records,                             \
+		.record_size = sizeof(_type),                                  \
+		.size = _size,                                                 \
+	}
+
+/**
+ * @brief Add a record. Only to be called by the producer.
+ *
+ * @param[in,out] queue Pointer to queue.
+ * @param[in] record Record that is copied into the queue.
+ *
+ * @return 0 on success or -ENOMEM if the queue is full.
+ */
+int sample_queue_put(struct sample_queue *queue, const void *record);
+
+/**
+ * @brief Take the oldest record. Only to be called by the consumer.
+ *
+ * @param[in,out] queue Pointer to queue.
+ * @param[out] record Buffer that the record is copied to.
+ *
+ * @return 0 on success or -ENODATA if the queue is empty.
+ */
+int sample_queue_get(struct sample_queue *queue, void *record);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Test of the data store on the flash simulator of native_posix. A reboot is
+ * simulated by initializing the store again, which only keeps the content of
+ * the flash.
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <storage/flash_map.h>
+#include "data_store.h"
+
+#define TEST_TYPE 3
+/* More entries than the storage partition holds. */
+#define TEST_FILL_COUNT 1000
+
+struct test_entry {
+	uint32_t seq;
+	uint8_t fill[DATA_STORE_ENTRY_MAX - sizeof(uint32_t)];
+};
+
+static void store_reset(void)
+{
+	int err;
+	const struct flash_area *fap;
+
+	err = flash_area_open(FLASH_AREA_ID(storage), &fap);
+	zassert_equal(err, 0, "flash_area_open, error: %d", err);
+
+	err = flash_area_erase(fap, 0, fap->fa_size);
+	flash_area_close(fap);
+	zassert_equal(err, 0, "flash_area_erase, error: %d", err);
+
+	err = data_store_init();
+	zassert_equal(err, 0, "data_store_init, error: %d", err);
+}
+
+static void reboot(void)
+{
+	int err = data_store_init();
+
+	zassert_equal(err, 0, "data_store_init, error: %d", err);
+}
+
+static void append(uint32_t seq)
+{
+	struct test_entry entry = { .seq = seq };
+	int err;
+
+	memset(entry.fill, (uint8_t)seq, sizeof(entry.fill));
+
+	err = data_store_append(TEST_TYPE, &entry, sizeof(entry));
+	zassert_equal(err, 0, "data_store_append, error: %d", err);
+}
+
+static int entry_read(struct test_entry *entry)
+{
+	uint8_t type = 0;
+	size_t len = 0;
+	int err;
+
+	err = data_store_read(&type, entry, sizeof(*entry), &len);
+	if (err) {
+		return err;
+	}
+
+	zassert_equal(type, TEST_TYPE, "Wrong type %d", type);
+	zassert_equal(len, sizeof(*entry), "Wrong length %zu", len);
+
+	for (size_t i = 0; i < sizeof(entry->fill); i++) {
+		zassert_equal(entry->fill[i], (uint8_t)entry->seq,
+			      "Entry %u corrupted", entry->seq);
+	}
+
+	return 0;
+}
+
+static void read_expect(uint32_t seq)
+{
+	struct test_entry entry;
+	int err = entry_read(&entry);
+
+	zassert_equal(err, 0, "data_store_read, error: %d", err);
+	zassert_equal(entry.seq, seq, "Read entry %u, expected %u", entry.seq,
+		      seq);
+}
+
+static void read_end_expect(void)
+{
+	struct test_entry entry;
+	int err = entry_read(&entry);
+
+	zassert_equal(err, -ENODATA, "Unexpected entry, error: %d", err);
+}
+
+static void consume(void)
+{
+	int err = data_store_consume();
+
+	zassert_equal(err, 0, "data_store_consume, error: %d", err);
+}
+
+/* Entries are read in the order they were appended, also those appended
+ * after all entries were read. Entries too long for the buffer are skipped.
+ */
+static void test_read_order(void)
+{
+	uint8_t type;
+	uint32_t value = 0x12345678;
+	size_t len;
+	int err;
+
+	store_reset();
+	read_end_expect();
+
+	for (uint32_t i = 1; i <= 5; i++) {
+		append(i);
+	}
+
+	for (uint32_t i = 1; i <= 5; i++) {
+		read_expect(i);
+	}
+
+	read_end_expect();
+
+	append(6);
+	read_expect(6);
+	read_end_expect();
+
+	append(7);
+	err = data_store_append(TEST_TYPE + 1, &value, sizeof(value));
+	zassert_equal(err, 0, "data_store_append, error: %d", err);
+
+	value = 0;
+	err = data_store_read(&type, &value, sizeof(value), &len);
+	zassert_equal(err, 0, "data_store_read, error: %d", err);
+	zassert_equal(type, TEST_TYPE + 1, "Wrong type %d", type);
+	zassert_equal(len, sizeof(value), "Wrong length %zu", len);
+	zassert_equal(value, 0x12345678, "Wrong value 0x%x", value);
+
+	err = data_store_append(DATA_STORE_TYPE_MAX + 1, &value,
+				sizeof(value));
+	zassert_equal(err, -EINVAL, "Reserved type appended");
+}
+
+/* After a reboot the entries that were not consumed are read again, and new
+ * entries continue the sequence.
+ */
+static void test_recovery(void)
+{
+	store_reset();
+
+	for (uint32_t i = 1; i <= 5; i++) {
+		append(i);
+	}
+
+	read_expect(1);
+	read_expect(2);
+	consume();
+	read_expect(3);
+
+	reboot();
+
+	read_expect(3);
+	read_expect(4);
+	read_expect(5);
+	read_end_expect();
+	consume();
+
+	append(6);
+
+	reboot();
+
+	read_expect(6);
+	read_end_expect();
+
+	/* Read but not consumed. */
+	reboot();
+
+	read_expect(6);
+	append(7);
+	read_expect(7);
+	consume();
+
+	reboot();
+
+	read_end_expect();
+	append(8);
+	read_expect(8);
+	read_end_expect();
+}
+
+/* Entries that were read after the last consumed one are read again after a
+ * rewind, as when publishing them failed.
+ */
+static void test_rewind(void)
+{
+	int err;
+
+	store_reset();
+
+	for (uint32_t i = 1; i <= 4; i++) {
+		append(i);
+	}
+
+	read_expect(1);
+	consume();
+	read_expect(2);
+	read_expect(3);
+
+	err = data_store_rewind();
+	zassert_equal(err, 0, "data_store_rewind, error: %d", err);
+
+	read_expect(2);
+	read_expect(3);
+	read_expect(4);
+	read_end_expect();
+	consume();
+
+	err = data_store_rewind();
+	zassert_equal(err, 0, "data_store_rewind, error: %d", err);
+	read_end_expect();
+}
+
+/* A full store erases its oldest sector, the newest entries are kept in
+ * order. Consuming all entries erases their sectors, and no consumed entry
+ * is read again after its sector and marker have been rotated.
+ */
+static void test_sector_rotation(void)
+{
+	struct test_entry entry;
+	uint32_t first;
+	uint32_t count;
+	uint32_t seq;
+
+	store_reset();
+
+	for (uint32_t i = 0; i < TEST_FILL_COUNT; i++) {
+		append(i);
+	}
+
+	zassert_equal(entry_read(&entry), 0, "Store empty");
+	first = entry.seq;
+	zassert_true(first > 0, "Oldest entries not dropped");
+
+	for (seq = first + 1; entry_read(&entry) == 0; seq++) {
+		zassert_equal(entry.seq, seq, "Read entry %u, expected %u",
+			      entry.seq, seq);
+	}
+
+	zassert_equal(seq, TEST_FILL_COUNT, "Entries missing, last %u",
+		      seq - 1);
+	consume();
+
+	reboot();
+
+	read_end_expect();
+
+	/* The consumed sectors are erased and make room for new entries. */
+	count = (TEST_FILL_COUNT - first) / 2;
+
+	for (uint32_t i = 0; i < count; i++) {
+		append(TEST_FILL_COUNT + i);
+	}
+
+	reboot();
+
+	for (uint32_t i = 0; i < count; i++) {
+		read_expect(TEST_FILL_COUNT + i);
+	}
+
+	read_end_expect();
+	consume();
+
+	/* An entry is consumed in a sector that is then rotated. */
+	for (uint32_t i = 0; i < TEST_FILL_COUNT; i++) {
+		append(2 * TEST_FILL_COUNT + i);
+
+		if (i == 1) {
+			read_expect(2 * TEST_FILL_COUNT);
+			consume();
+		}
+	}
+
+	reboot();
+
+	zassert_equal(entry_read(&entry), 0, "Store empty");
+	first = entry.seq;
+	zassert_true(first > 2 * TEST_FILL_COUNT,
+		     "Entry %u consumed but read", first);
+
+	for (seq = first + 1; entry_read(&entry) == 0; seq++) {
+		zassert_equal(entry.seq, seq, "Read entry %u, expected %u",
+			      entry.seq, seq);
+	}
+
+	zassert_equal(seq, 3 * TEST_FILL_COUNT, "Entries missing, last %u",
+		      seq - 1);
+}
+
+void test_main(void)
+{
+	ztest_test_suite(data_store,
+			 ztest_unit_test(test_read_order),
+			 ztest_unit_test(test_recovery),
+			 ztest_unit_test(test_rewind),
+			 ztest_unit_test(test_sector_rotation));
+
+	ztest_run_test_suite(data_store);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Kconfig defaults of the modules built for the host tests. A test
+ *	 target overrides them with compile definitions.
+ */
+
+#ifndef HOST_AUTOCONF_H__
+#define HOST_AUTOCONF_H__
+
+#if !defined(CONFIG_SERIALIZATION_CBOR) && !defined(CONFIG_SERIALIZATION_JSON)
+#define CONFIG_SERIALIZATION_JSON 1
+#endif
+
+#ifndef CONFIG_ENCODED_BATCH_LEN_MAX
+#define CONFIG_ENCODED_BATCH_LEN_MAX 2048
+#endif
+
+#define CONFIG_CLOUD_CODEC_FIELD_PRECISION 1
+#define CONFIG_CLOUD_CODEC_DELTA_REPORTING 1
+#define CONFIG_CLOUD_CODEC_DELTA_BAT_TOLERANCE 20
+#define CONFIG_CLOUD_CODEC_DELTA_RSRP_TOLERANCE 3
+#define CONFIG_CLOUD_CODEC_DELTA_ENV_TOLERANCE 5
+#define CONFIG_CLOUD_CODEC_STR_POOL_SIZE 8
+#define CONFIG_CLOUD_CODEC_STR_LEN_MAX 63
+#define CONFIG_CAT_TRACKER_LOG_LEVEL 0
+
+#endif
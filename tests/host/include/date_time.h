@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef HOST_DATE_TIME_H__
+#define HOST_DATE_TIME_H__
+
+#include <zephyr.h>
+
+int date_time_uptime_to_unix_time_ms(int64_t *uptime);
+
+int date_time_now(int64_t *unix_time_ms);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Logging is discarded in the host tests, but the arguments are still
+ *	 checked against the format strings.
+ */
+
+#ifndef HOST_LOGGING_LOG_H__
+#define HOST_LOGGING_LOG_H__
+
+#include <stddef.h>
+
+#define LOG_MODULE_REGISTER(...)
+#define LOG_MODULE_DECLARE(...)
+
+static inline __attribute__((format(printf, 1, 2)))
+void log_discard(const char *fmt, ...)
+{
+	(void)fmt;
+}
+
+#define LOG_ERR(...) log_discard(__VA_ARGS__)
+#define LOG_WRN(...) log_discard(__VA_ARGS__)
+#define LOG_INF(...) log_discard(__VA_ARGS__)
+#define LOG_DBG(...) log_discard(__VA_ARGS__)
+#define LOG_HEXDUMP_DBG(data, length, str)                                     \
+	((void)(data), (void)(length), (void)(str))
+
+static inline const char *log_strdup(const char *str)
+{
+	return str;
+}
+
+#endif
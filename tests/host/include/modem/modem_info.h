@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief The cloud codec does not use the modem information API,
+ *	 cloud_codec.h only includes it for the application.
+ */
+
+#ifndef HOST_MODEM_MODEM_INFO_H__
+#define HOST_MODEM_MODEM_INFO_H__
+
+#endif
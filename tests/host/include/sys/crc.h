@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef HOST_SYS_CRC_H__
+#define HOST_SYS_CRC_H__
+
+#include <zephyr.h>
+
+uint32_t crc32_ieee_update(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif
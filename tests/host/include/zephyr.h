@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Subset of the Zephyr kernel API that the modules built for the host
+ *	 tests use. The functions are implemented in src/zephyr_shim.c.
+ */
+
+#ifndef HOST_ZEPHYR_H__
+#define HOST_ZEPHYR_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <autoconf.h>
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define ARG_UNUSED(x) (void)(x)
+#define BIT(n) (1UL << (n))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#define BUILD_ASSERT(cond, ...) _Static_assert(cond, #cond)
+#define __ASSERT(cond, ...) ((void)(cond))
+#define __ASSERT_NO_MSG(cond) ((void)(cond))
+#define __packed __attribute__((__packed__))
+
+/* IS_ENABLED() as in sys/util_macro.h. */
+#define Z_XXXX1 Z_YYYY,
+#define IS_ENABLED(config_macro) Z_IS_ENABLED1(config_macro)
+#define Z_IS_ENABLED1(config_macro) Z_IS_ENABLED2(Z_XXXX##config_macro)
+#define Z_IS_ENABLED2(one_or_two_args) Z_IS_ENABLED3(one_or_two_args 1, 0)
+#define Z_IS_ENABLED3(ignore_this, val, ...) val
+
+int64_t k_uptime_get(void);
+uint32_t k_cycle_get_32(void);
+uint64_t k_cyc_to_ns_floor64(uint64_t cycles);
+void printk(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#endif
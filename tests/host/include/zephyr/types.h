@@ -0,0 +1,12 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#ifndef HOST_ZEPHYR_TYPES_H__
+#define HOST_ZEPHYR_TYPES_H__
+
+#include <stdint.h>
+
+#endif
@@ -0,0 +1,362 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Benchmark of every cloud codec operation. Each one is run on full
+ * synthetic buffers of each data type and reported as one line,
+ * "<BENCH:CODEC> codec=<backend> op=<operation> entries=<n> bytes=<n> ns=<n>
+ * ns_per_entry=<n> bytes_per_entry=<n> allocs=<n> peak_heap=<n>", where ns
+ * is the median of all runs and allocs and peak_heap are the heap usage of a
+ * single run. The benchmark fails if an operation allocates memory, the
+ * codec encodes into the caller's buffer.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cloud_codec.h>
+#include <cloud_codec_backend.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define BENCH_RUNS 501
+#define BENCH_RING_SIZE 20
+#define BENCH_GPS_BATCH_SIZE 7
+
+#if defined(CONFIG_SERIALIZATION_CBOR)
+#define BENCH_CODEC "cbor"
+#else
+#define BENCH_CODEC "json"
+#endif
+
+union data_entry {
+	struct cloud_data_gps gps;
+	struct cloud_data_sensors sensors;
+	struct cloud_data_modem modem;
+	struct cloud_data_ui ui;
+	struct cloud_data_accelerometer accel;
+	struct cloud_data_battery bat;
+};
+
+DATA_POOL_DEFINE(data_pool, union data_entry, 6 * BENCH_RING_SIZE);
+DATA_RING_DEFINE(gps_ring, struct cloud_data_gps, BENCH_RING_SIZE, data_pool,
+		 5);
+DATA_RING_DEFINE(sensor_ring, struct cloud_data_sensors, BENCH_RING_SIZE,
+		 data_pool, 3);
+DATA_RING_DEFINE(modem_ring, struct cloud_data_modem, BENCH_RING_SIZE,
+		 data_pool, 2);
+DATA_RING_DEFINE(ui_ring, struct cloud_data_ui, BENCH_RING_SIZE, data_pool,
+		 0);
+DATA_RING_DEFINE(accel_ring, struct cloud_data_accelerometer,
+		 BENCH_RING_SIZE, data_pool, 4);
+DATA_RING_DEFINE(bat_ring, struct cloud_data_battery, BENCH_RING_SIZE,
+		 data_pool, 1);
+
+static char buf[4096];
+static char response[256];
+static size_t response_len;
+static struct cloud_data_cfg cfg;
+static struct cloud_data_gps gps;
+static struct cloud_data_sensors sensors;
+static struct cloud_data_modem modem;
+static struct cloud_data_modem_static modem_static;
+static struct cloud_data_ui ui;
+static struct cloud_data_accelerometer accel;
+static struct cloud_data_battery bat;
+static uint8_t modem_ip;
+static uint8_t modem_mccmnc;
+
+/* Entries of the worst case size, i is the age of the entry in seconds. */
+static void entries_set(int i)
+{
+	uint32_t ts = cloud_data_ts(host_uptime_ms - 1000 * (i + 1));
+
+	gps = (struct cloud_data_gps){
+		.gps_ts = ts,
+		.longi = -179123456 + i * 1234,
+		.lat = -89123456 + i * 567,
+		.alt = 123456 + i,
+		.acc = 6500 + i,
+		.spd = 6500 + i,
+		.hdg = 3599 - i,
+	};
+	sensors = (struct cloud_data_sensors){
+		.env_ts = ts, .temp = -1234 + i, .hum = 1000 - i,
+	};
+	modem = (struct cloud_data_modem){
+		.mod_ts = ts,
+		.area = 65535 - i,
+		.cell = 65535 - i,
+		.rsrp = 140 - i,
+		.ip = modem_ip,
+		.mccmnc = modem_mccmnc,
+	};
+	ui = (struct cloud_data_ui){ .btn_ts = ts, .btn = 1 + i % 2 };
+	accel = (struct cloud_data_accelerometer){
+		.ts = ts, .values = { -1999 + i, 1999 - i, -1999 },
+	};
+	bat = (struct cloud_data_battery){ .bat_ts = ts, .bat = 4500 - i };
+}
+
+static void rings_clear(void)
+{
+	struct data_ring *rings[] = {
+		&gps_ring, &sensor_ring, &modem_ring,
+		&ui_ring, &accel_ring, &bat_ring,
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(rings); i++) {
+		data_ring_pop(rings[i], data_ring_count(rings[i]));
+	}
+}
+
+static void rings_fill(struct data_ring *ring, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		entries_set(i);
+
+		if (ring == &gps_ring) {
+			data_ring_put(ring, &gps);
+		} else if (ring == &sensor_ring) {
+			data_ring_put(ring, &sensors);
+		} else if (ring == &modem_ring) {
+			data_ring_put(ring, &modem);
+		} else if (ring == &ui_ring) {
+			data_ring_put(ring, &ui);
+		} else if (ring == &accel_ring) {
+			data_ring_put(ring, &accel);
+		} else {
+			data_ring_put(ring, &bat);
+		}
+	}
+}
+
+struct bench_op {
+	const char *name;
+	/* Prepare the input, not part of the measurement. */
+	void (*setup)(void);
+	/* Run the operation once into output. */
+	int (*run)(struct cloud_codec_data *output);
+	/* Number of entries of the input, 0 if the operation reports it. */
+	size_t entries;
+};
+
+static void data_setup(void)
+{
+	entries_set(0);
+	cloud_codec_session_reset();
+}
+
+static int data_run(struct cloud_codec_data *output)
+{
+	static struct cloud_codec_report report;
+
+	return cloud_codec_encode_data(output, &report, &gps, &sensors,
+				       &modem, &modem_static, &ui, &accel,
+				       &bat);
+}
+
+static void ui_setup(void)
+{
+	entries_set(0);
+}
+
+static int ui_run(struct cloud_codec_data *output)
+{
+	return cloud_codec_encode_ui_data(output, &ui);
+}
+
+static void cfg_setup(void)
+{
+	cfg = (struct cloud_data_cfg){
+		.act = true,
+		.gpst = 1000,
+		.actw = 3600,
+		.pasw = 3600,
+		.movt = 3600,
+		.acct = 100,
+	};
+}
+
+static int cfg_run(struct cloud_codec_data *output)
+{
+	return cloud_codec_encode_cfg_data(output, &cfg);
+}
+
+/* A device shadow delta document as it is received from the cloud. */
+static void decode_setup(void)
+{
+	struct codec_writer w;
+
+	codec_writer_init(&w, response, sizeof(response));
+	codec_writer_obj_start(&w, NULL);
+	codec_writer_number(&w, "version", 1234);
+	codec_writer_number(&w, "timestamp", 1612345678);
+	codec_writer_obj_start(&w, "state");
+	codec_writer_obj_start(&w, "cfg");
+	codec_writer_bool(&w, "act", false);
+	codec_writer_number(&w, "gpst", 60);
+	codec_writer_number(&w, "actwt", 60);
+	codec_writer_number(&w, "mvres", 300);
+	codec_writer_number(&w, "mvt", 3600);
+	codec_writer_number(&w, "acct", 10);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_start(&w, "metadata");
+	codec_writer_obj_start(&w, "cfg");
+	codec_writer_obj_start(&w, "act");
+	codec_writer_number(&w, "timestamp", 1612345678);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_end(&w);
+	codec_writer_finish(&w);
+	response_len = w.len;
+	cfg_setup();
+}
+
+static int decode_run(struct cloud_codec_data *output)
+{
+	output->len = response_len;
+
+	return cloud_codec_decode_response(response, response_len, &cfg);
+}
+
+static void batch_gps_setup(void)
+{
+	rings_clear();
+	rings_fill(&gps_ring, BENCH_GPS_BATCH_SIZE);
+}
+
+/* Setups of batches of a single data type. */
+#define BATCH_SETUP(_type)                                                     \
+	static void batch_##_type##_setup(void)                                \
+	{                                                                      \
+		rings_clear();                                                 \
+		rings_fill(&_type##_ring, BENCH_RING_SIZE);                    \
+	}
+
+BATCH_SETUP(sensor)
+BATCH_SETUP(modem)
+BATCH_SETUP(ui)
+BATCH_SETUP(accel)
+BATCH_SETUP(bat)
+
+static void batch_full_setup(void)
+{
+	rings_clear();
+	rings_fill(&gps_ring, BENCH_RING_SIZE);
+	rings_fill(&sensor_ring, BENCH_RING_SIZE);
+	rings_fill(&modem_ring, BENCH_RING_SIZE);
+	rings_fill(&ui_ring, BENCH_RING_SIZE);
+	rings_fill(&accel_ring, BENCH_RING_SIZE);
+	rings_fill(&bat_ring, BENCH_RING_SIZE);
+}
+
+static int batch_run(struct cloud_codec_data *output)
+{
+	return cloud_codec_encode_batch(output, &gps_ring, &sensor_ring,
+					&modem_ring, &ui_ring, &accel_ring,
+					&bat_ring);
+}
+
+static const struct bench_op ops[] = {
+	{ "data", data_setup, data_run, 6 },
+	{ "ui", ui_setup, ui_run, 1 },
+	{ "cfg", cfg_setup, cfg_run, 1 },
+	{ "decode", decode_setup, decode_run, 1 },
+	{ "batch_gps", batch_gps_setup, batch_run, 0 },
+	{ "batch_sensor", batch_sensor_setup, batch_run, 0 },
+	{ "batch_modem", batch_modem_setup, batch_run, 0 },
+	{ "batch_ui", batch_ui_setup, batch_run, 0 },
+	{ "batch_accel", batch_accel_setup, batch_run, 0 },
+	{ "batch_bat", batch_bat_setup, batch_run, 0 },
+	{ "batch_full", batch_full_setup, batch_run, 0 },
+};
+
+static int ns_compare(const void *a, const void *b)
+{
+	uint64_t ns_a = *(const uint64_t *)a;
+	uint64_t ns_b = *(const uint64_t *)b;
+
+	return (ns_a > ns_b) - (ns_a < ns_b);
+}
+
+static int bench_run(const struct bench_op *op)
+{
+	static uint64_t ns[BENCH_RUNS];
+	struct cloud_codec_data output;
+	struct host_heap_stats heap = { 0 };
+	size_t entries;
+	int err = 0;
+
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		uint64_t start;
+
+		output = (struct cloud_codec_data){
+			.buf = buf, .size = sizeof(buf),
+		};
+
+		op->setup();
+		host_heap_reset();
+		start = host_ns_get();
+		err = op->run(&output);
+		ns[i] = host_ns_get() - start;
+
+		if (i == 0) {
+			heap = host_heap_get();
+		}
+
+		if (err) {
+			printf("%s: error %d\n", op->name, err);
+			return err;
+		}
+	}
+
+	qsort(ns, BENCH_RUNS, sizeof(ns[0]), ns_compare);
+
+	entries = op->entries ? op->entries : output.entries;
+
+	printf("<BENCH:CODEC> codec=%s op=%s entries=%zu bytes=%zu ns=%llu "
+	       "ns_per_entry=%llu bytes_per_entry=%zu allocs=%zu "
+	       "peak_heap=%zu\n", BENCH_CODEC, op->name, entries, output.len,
+	       (unsigned long long)ns[BENCH_RUNS / 2],
+	       (unsigned long long)ns[BENCH_RUNS / 2] / entries,
+	       output.len / entries, heap.allocs, heap.peak);
+
+	return heap.allocs ? -ENOMEM : 0;
+}
+
+int main(void)
+{
+	modem_ip = cloud_codec_str_intern(
+		"2001:db8:85a3:8d3:1319:8a2e:370:7348");
+	modem_mccmnc = cloud_codec_str_intern("242201");
+	modem_static = (struct cloud_data_modem_static){
+		.ts = cloud_data_ts(host_uptime_ms - 1000),
+		.bnd = 20,
+		.nw_gps = true,
+		.nw_lte_m = true,
+		.appv = "0.0.0-development",
+		.brdv = "thingy91_nrf9160ns",
+		.fw = "mfw_nrf9160_1.2.2",
+		.iccid = "8931080019073497795F",
+	};
+
+	data_pool_init(&data_pool);
+	data_pool_ring_add(&gps_ring);
+	data_pool_ring_add(&sensor_ring);
+	data_pool_ring_add(&modem_ring);
+	data_pool_ring_add(&ui_ring);
+	data_pool_ring_add(&accel_ring);
+	data_pool_ring_add(&bat_ring);
+
+	for (size_t i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (bench_run(&ops[i])) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Microbenchmark of the data ring operations. Six rings of increasing
+ * priority share a pool that holds half of their entries, as the rings of
+ * the application do. Each operation is run on a full ring and reported as
+ * one line, "<BENCH:DATA_RING> op=<operation> entries=<n> ns=<n>
+ * ns_per_entry=<n> allocs=<n>", where ns is the median of all runs. The
+ * benchmark fails if an operation allocates memory.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define BENCH_RUNS 501
+#define BENCH_RING_SIZE 64
+#define BENCH_RING_COUNT 6
+
+/* The size of the largest entry of the application. */
+struct bench_entry {
+	uint32_t ts;
+	int32_t values[5];
+};
+
+DATA_POOL_DEFINE(pool, struct bench_entry,
+		 BENCH_RING_COUNT * BENCH_RING_SIZE / 2);
+DATA_RING_DEFINE(ring_0, struct bench_entry, BENCH_RING_SIZE, pool, 0);
+DATA_RING_DEFINE(ring_1, struct bench_entry, BENCH_RING_SIZE, pool, 1);
+DATA_RING_DEFINE(ring_2, struct bench_entry, BENCH_RING_SIZE, pool, 2);
+DATA_RING_DEFINE(ring_3, struct bench_entry, BENCH_RING_SIZE, pool, 3);
+DATA_RING_DEFINE(ring_4, struct bench_entry, BENCH_RING_SIZE, pool, 4);
+DATA_RING_DEFINE(ring_5, struct bench_entry, BENCH_RING_SIZE, pool, 5);
+
+static struct data_ring *rings[BENCH_RING_COUNT] = {
+	&ring_0, &ring_1, &ring_2, &ring_3, &ring_4, &ring_5,
+};
+
+static volatile uint32_t sink;
+
+static void rings_clear(void)
+{
+	for (size_t i = 0; i < BENCH_RING_COUNT; i++) {
+		data_ring_pop(rings[i], data_ring_count(rings[i]));
+	}
+}
+
+static void ring_fill(struct data_ring *ring)
+{
+	struct bench_entry entry = { 0 };
+
+	for (uint32_t i = 0; i < BENCH_RING_SIZE; i++) {
+		entry.ts = i;
+		data_ring_put(ring, &entry);
+	}
+}
+
+static void put_setup(void)
+{
+	rings_clear();
+}
+
+/* The ring is full, every entry replaces the oldest one. */
+static void put_full_setup(void)
+{
+	rings_clear();
+	ring_fill(&ring_5);
+}
+
+/* The pool is exhausted, every entry evicts one of the lowest priority. */
+static void put_evict_setup(void)
+{
+	rings_clear();
+	ring_fill(&ring_0);
+	ring_fill(&ring_1);
+	ring_fill(&ring_2);
+}
+
+static void put_run(void)
+{
+	ring_fill(&ring_5);
+}
+
+static void get_run(void)
+{
+	uint32_t sum = 0;
+
+	for (size_t i = 0; i < BENCH_RING_SIZE; i++) {
+		struct bench_entry *entry = data_ring_get(&ring_5, i);
+
+		sum += entry->ts;
+	}
+
+	sink = sum;
+}
+
+static void pop_run(void)
+{
+	for (size_t i = 0; i < BENCH_RING_SIZE; i++) {
+		data_ring_pop(&ring_5, 1);
+	}
+}
+
+static void newest_drop_run(void)
+{
+	for (size_t i = 0; i < BENCH_RING_SIZE; i++) {
+		data_ring_newest_drop(&ring_5);
+	}
+}
+
+static void remove_run(void)
+{
+	for (size_t i = 0; i < BENCH_RING_SIZE; i++) {
+		data_ring_remove(&ring_5, 0);
+	}
+}
+
+struct bench_op {
+	const char *name;
+	/* Prepare the rings, not part of the measurement. */
+	void (*setup)(void);
+	/* Run the operation on BENCH_RING_SIZE entries. */
+	void (*run)(void);
+};
+
+static const struct bench_op ops[] = {
+	{ "put", put_setup, put_run },
+	{ "put_full", put_full_setup, put_run },
+	{ "put_evict", put_evict_setup, put_run },
+	{ "get", put_full_setup, get_run },
+	{ "pop", put_full_setup, pop_run },
+	{ "newest_drop", put_full_setup, newest_drop_run },
+	{ "remove", put_full_setup, remove_run },
+};
+
+static int ns_compare(const void *a, const void *b)
+{
+	uint64_t ns_a = *(const uint64_t *)a;
+	uint64_t ns_b = *(const uint64_t *)b;
+
+	return (ns_a > ns_b) - (ns_a < ns_b);
+}
+
+static int bench_run(const struct bench_op *op)
+{
+	static uint64_t ns[BENCH_RUNS];
+	struct host_heap_stats heap = { 0 };
+
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		uint64_t start;
+
+		op->setup();
+		host_heap_reset();
+		start = host_ns_get();
+		op->run();
+		ns[i] = host_ns_get() - start;
+
+		if (i == 0) {
+			heap = host_heap_get();
+		}
+	}
+
+	qsort(ns, BENCH_RUNS, sizeof(ns[0]), ns_compare);
+
+	printf("<BENCH:DATA_RING> op=%s entries=%d ns=%llu ns_per_entry=%llu "
+	       "allocs=%zu\n", op->name, BENCH_RING_SIZE,
+	       (unsigned long long)ns[BENCH_RUNS / 2],
+	       (unsigned long long)ns[BENCH_RUNS / 2] / BENCH_RING_SIZE,
+	       heap.allocs);
+
+	return heap.allocs ? -ENOMEM : 0;
+}
+
+int main(void)
+{
+	data_pool_init(&pool);
+
+	for (size_t i = 0; i < BENCH_RING_COUNT; i++) {
+		data_pool_ring_add(rings[i]);
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(ops); i++) {
+		if (bench_run(&ops[i])) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
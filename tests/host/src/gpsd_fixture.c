@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Write a batch message with delta encoded GPS data, as it is published with
+ * CONFIG_GPS_BUFFER_DELTA_ENCODING, together with the entries it was encoded
+ * from:
+ *
+ * {"message":<batch message>,"gps":[<entry in the regular format>, ...]}
+ *
+ * ci/util/decodeGpsDelta.spec.ts checks that the reference decoder restores
+ * the entries from the message. The file is compared with the copy in
+ * ci/util/test-data, so a change of the encoding fails the host tests until
+ * the copy is updated and the decoder still passes.
+ */
+
+#include <stdio.h>
+#include <cloud_codec.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define FIXTURE_ENTRIES 5
+
+DATA_POOL_DEFINE(data_pool, struct cloud_data_gps, FIXTURE_ENTRIES);
+DATA_RING_DEFINE(gps_ring, struct cloud_data_gps, FIXTURE_ENTRIES, data_pool,
+		 0);
+
+/* Fixes of a track that crosses the antimeridian and the equator,
+ * { gps_ts, longi, lat, alt, acc, spd, hdg }.
+ */
+static const struct cloud_data_gps entries[FIXTURE_ENTRIES] = {
+	{ 40000, 179999000, 1000, -12, 55, 0, 0 },
+	{ 41050, 179999900, 400, 3, 48, 123, 3599 },
+	{ 42125, -179999800, -250, 27, 51, 1456, 1800 },
+	{ 99999, -179000001, -89999999, 88486, 65535, 65535, 1 },
+	{ 100000, -179000001, -89999999, 88486, 65535, 65535, 1 },
+};
+
+static char buf[2048];
+
+int main(int argc, char **argv)
+{
+	struct cloud_codec_data output = {
+		.buf = buf, .size = sizeof(buf),
+	};
+	FILE *file;
+	int err;
+
+	if (argc != 2) {
+		printf("usage: %s <file>\n", argv[0]);
+		return 1;
+	}
+
+	data_pool_init(&data_pool);
+	data_pool_ring_add(&gps_ring);
+
+	for (size_t i = 0; i < FIXTURE_ENTRIES; i++) {
+		data_ring_put(&gps_ring, &entries[i]);
+	}
+
+	err = cloud_codec_encode_batch(&output, &gps_ring, NULL, NULL, NULL,
+				       NULL, NULL);
+	if (err || (output.entries != FIXTURE_ENTRIES)) {
+		printf("cloud_codec_encode_batch, error: %d\n", err);
+		return 1;
+	}
+
+	file = fopen(argv[1], "w");
+	if (file == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	fprintf(file, "{\"message\":%.*s,\"gps\":[", (int)output.len, buf);
+
+	for (size_t i = 0; i < FIXTURE_ENTRIES; i++) {
+		const struct cloud_data_gps *e = &entries[i];
+
+		fprintf(file,
+			"%s{\"v\":{\"lng\":%.6f,\"lat\":%.6f,\"acc\":%.1f,"
+			"\"alt\":%.1f,\"spd\":%.1f,\"hdg\":%.1f},\"ts\":%lld}",
+			i ? "," : "", e->longi / 1e6, e->lat / 1e6,
+			e->acc / 10.0, e->alt / 10.0, e->spd / 10.0,
+			e->hdg / 10.0,
+			(long long)(HOST_UNIX_TIME_MS_AT_BOOT + e->gps_ts));
+	}
+
+	fprintf(file, "]}\n");
+
+	return fclose(file) ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Heap usage of the benchmarks. The linker wraps the allocator functions,
+ * see the --wrap options in CMakeLists.txt.
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+#include "host.h"
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static struct host_heap_stats stats;
+
+static void heap_add(void *ptr)
+{
+	if (ptr == NULL) {
+		return;
+	}
+
+	stats.allocs++;
+	stats.used += malloc_usable_size(ptr);
+	if (stats.used > stats.peak) {
+		stats.peak = stats.used;
+	}
+}
+
+static void heap_remove(void *ptr)
+{
+	size_t size;
+
+	if (ptr == NULL) {
+		return;
+	}
+
+	size = malloc_usable_size(ptr);
+	stats.used = (size < stats.used) ? stats.used - size : 0;
+}
+
+void *__wrap_malloc(size_t size)
+{
+	void *ptr = __real_malloc(size);
+
+	heap_add(ptr);
+
+	return ptr;
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	void *ptr = __real_calloc(count, size);
+
+	heap_add(ptr);
+
+	return ptr;
+}
+
+void *__wrap_realloc(void *ptr, size_t size)
+{
+	void *new_ptr;
+
+	new_ptr = __real_realloc(ptr, size);
+	if (new_ptr != NULL) {
+		heap_remove(ptr);
+		heap_add(new_ptr);
+	}
+
+	return new_ptr;
+}
+
+void __wrap_free(void *ptr)
+{
+	heap_remove(ptr);
+	__real_free(ptr);
+}
+
+void host_heap_reset(void)
+{
+	stats = (struct host_heap_stats){ 0 };
+}
+
+struct host_heap_stats host_heap_get(void)
+{
+	return stats;
+}
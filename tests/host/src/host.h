@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/**@file
+ *@brief Helpers shared by the host tests and benchmarks.
+ */
+
+#ifndef HOST_H__
+#define HOST_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Uptime returned by k_uptime_get(), in milliseconds. */
+extern int64_t host_uptime_ms;
+
+/** Whether date_time has obtained the time, see date_time_now(). */
+extern bool host_time_valid;
+
+/** UNIX time in milliseconds at uptime 0. */
+#define HOST_UNIX_TIME_MS_AT_BOOT 1612345678000LL
+
+/** @brief Get a monotonic time stamp in nanoseconds. */
+uint64_t host_ns_get(void);
+
+/** @brief Heap usage since the last call to @ref host_heap_reset. */
+struct host_heap_stats {
+	/** Number of allocations. */
+	size_t allocs;
+	/** Largest number of bytes allocated at the same time. */
+	size_t peak;
+	/** Number of bytes that are allocated. */
+	size_t used;
+};
+
+void host_heap_reset(void);
+
+struct host_heap_stats host_heap_get(void);
+
+/** Number of failed checks of the running test program. */
+extern int host_failures;
+
+/** @brief Check a condition and report it if it does not hold. */
+#define CHECK(cond)                                                            \
+	do {                                                                   \
+		if (!(cond)) {                                                 \
+			printf("%s:%d: check failed: %s\n", __FILE__,          \
+			       __LINE__, #cond);                               \
+			host_failures++;                                       \
+		}                                                              \
+	} while (0)
+
+/** @brief Check that two integers are equal and report them if not. */
+#define CHECK_EQ(a, b)                                                         \
+	do {                                                                   \
+		long long _a = (long long)(a);                                 \
+		long long _b = (long long)(b);                                 \
+		if (_a != _b) {                                                \
+			printf("%s:%d: check failed: %s == %s "                \
+			       "(%lld != %lld)\n", __FILE__, __LINE__, #a, #b, \
+			       _a, _b);                                        \
+			host_failures++;                                       \
+		}                                                              \
+	} while (0)
+
+/** @brief Exit status of a test program. */
+static inline int host_result(const char *name)
+{
+	printf("%s: %s\n", name, host_failures ? "FAIL" : "PASS");
+
+	return host_failures ? 1 : 0;
+}
+
+#endif
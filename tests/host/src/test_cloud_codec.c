@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Test of the backend independent part of the cloud codec, built with the
+ * JSON backend.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <cloud_codec.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define RING_SIZE 4
+
+DATA_POOL_DEFINE(data_pool, struct cloud_data_gps, RING_SIZE);
+DATA_RING_DEFINE(gps_ring, struct cloud_data_gps, RING_SIZE, data_pool, 0);
+DATA_POOL_DEFINE(modem_pool, struct cloud_data_modem, RING_SIZE);
+DATA_RING_DEFINE(modem_ring, struct cloud_data_modem, RING_SIZE, modem_pool,
+		 0);
+
+static char buf[1024];
+static struct cloud_codec_data output = { .buf = buf, .size = sizeof(buf) };
+static struct cloud_codec_report report;
+
+static struct cloud_data_gps gps = {
+	.gps_ts = 99000, .longi = 10123456, .lat = 63123456,
+};
+static struct cloud_data_battery bat = { .bat_ts = 99000, .bat = 3800 };
+static struct cloud_data_ui ui = { .btn_ts = 99000, .btn = 1 };
+
+/* Entries are kept with -EAGAIN until the UNIX time is known, -ENODATA
+ * means that there is nothing to encode.
+ */
+static void test_time_unknown(void)
+{
+	host_time_valid = false;
+
+	CHECK_EQ(cloud_codec_encode_data(&output, &report, &gps, NULL, NULL,
+					 NULL, NULL, NULL, &bat), -EAGAIN);
+	CHECK_EQ(cloud_codec_encode_ui_data(&output, &ui), -EAGAIN);
+
+	data_ring_put(&gps_ring, &gps);
+	CHECK_EQ(cloud_codec_encode_batch(&output, &gps_ring, NULL, NULL,
+					  NULL, NULL, NULL), -EAGAIN);
+	CHECK_EQ(data_ring_count(&gps_ring), 1);
+
+	host_time_valid = true;
+
+	CHECK_EQ(cloud_codec_encode_data(&output, &report, NULL, NULL, NULL,
+					 NULL, NULL, NULL, NULL), -ENODATA);
+	CHECK_EQ(cloud_codec_encode_ui_data(&output, NULL), -ENODATA);
+	CHECK_EQ(cloud_codec_encode_batch(&output, &gps_ring, NULL, NULL,
+					  NULL, NULL, NULL), 0);
+	CHECK_EQ(data_ring_count(&gps_ring), 0);
+	CHECK_EQ(cloud_codec_encode_batch(&output, &gps_ring, NULL, NULL,
+					  NULL, NULL, NULL), -ENODATA);
+}
+
+static void modem_entry_release(const void *entry)
+{
+	const struct cloud_data_modem *modem = entry;
+
+	cloud_codec_str_release(modem->ip);
+	cloud_codec_str_release(modem->mccmnc);
+}
+
+/* Slots of the string pool are not reused while entries refer to them. */
+static void test_str_pool(void)
+{
+	struct cloud_data_modem modem = {
+		.mod_ts = 99000,
+		.ip = cloud_codec_str_intern("10.1.2.3"),
+		.mccmnc = CLOUD_CODEC_STR_NONE,
+	};
+	uint8_t ids[CONFIG_CLOUD_CODEC_STR_POOL_SIZE];
+	char str[16];
+
+	CHECK(modem.ip != CLOUD_CODEC_STR_NONE);
+	CHECK(data_ring_put(&modem_ring, &modem));
+
+	/* Equal strings share a slot. */
+	ids[0] = cloud_codec_str_intern("10.1.2.3");
+	CHECK_EQ(ids[0], modem.ip);
+	cloud_codec_str_release(ids[0]);
+
+	for (size_t i = 1; i < ARRAY_SIZE(ids); i++) {
+		snprintf(str, sizeof(str), "str%zu", i);
+		ids[i] = cloud_codec_str_intern(str);
+		CHECK(ids[i] != CLOUD_CODEC_STR_NONE);
+		CHECK(ids[i] != modem.ip);
+	}
+
+	/* All slots are referenced. */
+	CHECK_EQ(cloud_codec_str_intern("10.9.9.9"), CLOUD_CODEC_STR_NONE);
+	cloud_codec_str_release(CLOUD_CODEC_STR_NONE);
+
+	host_time_valid = true;
+	output.len = 0;
+	CHECK_EQ(cloud_codec_encode_batch(&output, NULL, NULL, &modem_ring,
+					  NULL, NULL, NULL), 0);
+	buf[MIN(output.len, sizeof(buf) - 1)] = '\0';
+	CHECK(strstr(buf, "\"10.1.2.3\"") != NULL);
+
+	/* The published entry released its slot, the least recently interned
+	 * of the free slots is reused.
+	 */
+	CHECK_EQ(data_ring_count(&modem_ring), 0);
+	cloud_codec_str_release(ids[3]);
+	CHECK_EQ(cloud_codec_str_intern("10.9.9.9"), modem.ip);
+	CHECK_EQ(cloud_codec_str_intern("10.9.9.8"), ids[3]);
+	CHECK_EQ(cloud_codec_str_intern("10.9.9.7"), CLOUD_CODEC_STR_NONE);
+}
+
+static int report_encode(struct cloud_data_modem_static *modem_static,
+			 struct cloud_data_battery *bat_buf)
+{
+	int err;
+
+	output.len = 0;
+	err = cloud_codec_encode_data(&output, &report, NULL, NULL, NULL,
+				      modem_static, NULL, NULL, bat_buf);
+	buf[MIN(output.len, sizeof(buf) - 1)] = '\0';
+	cloud_codec_release_data(&output);
+
+	return err;
+}
+
+/* Reported values and static modem data are only left out of later reports
+ * once a report that included them is committed, as after it was published.
+ */
+static void test_report_commit(void)
+{
+	struct cloud_data_modem_static modem_static = {
+		.ts = 99000,
+		.appv = "1.0.0",
+		.brdv = "nrf9160dk_nrf9160ns",
+		.fw = "mfw_nrf9160_1.2.2",
+		.iccid = "8931080019073497795",
+	};
+	struct cloud_codec_report stale;
+
+	host_time_valid = true;
+	cloud_codec_session_reset();
+
+	/* Not published, reported again. */
+	CHECK_EQ(report_encode(&modem_static, &bat), 0);
+	CHECK(strstr(buf, "\"bat\"") != NULL);
+	CHECK(strstr(buf, "\"appV\"") != NULL);
+
+	CHECK_EQ(report_encode(&modem_static, &bat), 0);
+	CHECK(strstr(buf, "\"bat\"") != NULL);
+	CHECK(strstr(buf, "\"appV\"") != NULL);
+
+	cloud_codec_report_commit(&report);
+	CHECK_EQ(report_encode(&modem_static, &bat), -ENODATA);
+
+	/* A changed value is reported until it is committed. */
+	bat.bat += 100;
+	CHECK_EQ(report_encode(NULL, &bat), 0);
+	CHECK(strstr(buf, "\"bat\"") != NULL);
+	CHECK_EQ(report_encode(NULL, &bat), 0);
+	cloud_codec_report_commit(&report);
+	CHECK_EQ(report_encode(NULL, &bat), -ENODATA);
+
+	/* A report encoded before the session was reset is not committed. */
+	CHECK_EQ(report_encode(NULL, NULL), -ENODATA);
+	bat.bat += 100;
+	CHECK_EQ(report_encode(&modem_static, &bat), 0);
+	stale = report;
+	cloud_codec_session_reset();
+	cloud_codec_report_commit(&stale);
+	CHECK_EQ(report_encode(&modem_static, &bat), 0);
+	CHECK(strstr(buf, "\"bat\"") != NULL);
+	CHECK(strstr(buf, "\"appV\"") != NULL);
+	cloud_codec_report_commit(&report);
+	CHECK_EQ(report_encode(&modem_static, &bat), -ENODATA);
+}
+
+int main(void)
+{
+	data_pool_init(&data_pool);
+	data_pool_ring_add(&gps_ring);
+	data_pool_init(&modem_pool);
+	modem_ring.release = modem_entry_release;
+	data_pool_ring_add(&modem_ring);
+
+	test_time_unknown();
+	test_str_pool();
+	test_report_commit();
+
+	return host_result("test_cloud_codec");
+}
@@ -0,0 +1,738 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Conformance test of the CBOR backend of the cloud codec. The writer is
+ * checked against the examples of appendix A of RFC 7049, the decoder against
+ * hand encoded messages, and every data type is encoded and read back with a
+ * CBOR reader of the test that is independent from the one of the backend.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cloud_codec.h>
+#include <cloud_codec_backend.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define RING_SIZE 4
+
+union data_entry {
+	struct cloud_data_gps gps;
+	struct cloud_data_sensors sensors;
+	struct cloud_data_modem modem;
+	struct cloud_data_ui ui;
+	struct cloud_data_accelerometer accel;
+	struct cloud_data_battery bat;
+};
+
+DATA_POOL_DEFINE(data_pool, union data_entry, 6 * RING_SIZE);
+DATA_RING_DEFINE(gps_ring, struct cloud_data_gps, RING_SIZE, data_pool, 5);
+DATA_RING_DEFINE(sensor_ring, struct cloud_data_sensors, RING_SIZE, data_pool,
+		 3);
+DATA_RING_DEFINE(modem_ring, struct cloud_data_modem, RING_SIZE, data_pool,
+		 2);
+DATA_RING_DEFINE(ui_ring, struct cloud_data_ui, RING_SIZE, data_pool, 0);
+DATA_RING_DEFINE(accel_ring, struct cloud_data_accelerometer, RING_SIZE,
+		 data_pool, 4);
+DATA_RING_DEFINE(bat_ring, struct cloud_data_battery, RING_SIZE, data_pool,
+		 1);
+
+static uint8_t buf[2048];
+
+/* A data item found by the reader of the test. */
+struct item {
+	/* Encoded item, including all nested items. */
+	const uint8_t *start;
+	size_t len;
+	uint8_t major;
+	uint8_t info;
+	uint64_t arg;
+	/* Value of integers and floats. */
+	double number;
+};
+
+static double half_to_double(uint16_t half)
+{
+	int exp = (half >> 10) & 0x1F;
+	double mant = half & 0x3FF;
+	double value;
+
+	if (exp == 0) {
+		value = ldexp(mant, -24);
+	} else if (exp != 31) {
+		value = ldexp(mant + 1024, exp - 25);
+	} else {
+		value = (mant == 0) ? INFINITY : NAN;
+	}
+
+	return (half & 0x8000) ? -value : value;
+}
+
+/* Parse the item at the start of data. Returns its length or 0 if it is not
+ * well-formed.
+ */
+static size_t item_parse(const uint8_t *data, size_t len, struct item *item)
+{
+	size_t pos = 1;
+	size_t arg_len = 0;
+	struct item nested;
+
+	if (len == 0) {
+		return 0;
+	}
+
+	*item = (struct item){
+		.start = data, .major = data[0] >> 5, .info = data[0] & 0x1F,
+	};
+
+	if (item->info < 24) {
+		item->arg = item->info;
+	} else if (item->info <= 27) {
+		arg_len = 1 << (item->info - 24);
+	} else if (item->info != 31) {
+		return 0;
+	}
+
+	if (len < pos + arg_len) {
+		return 0;
+	}
+
+	for (size_t i = 0; i < arg_len; i++) {
+		item->arg = (item->arg << 8) | data[pos++];
+	}
+
+	switch (item->major) {
+	case 0:
+		item->number = item->arg;
+		break;
+	case 1:
+		item->number = -1.0 - (double)item->arg;
+		break;
+	case 2:
+	case 3:
+		if (item->info == 31 || item->arg > len - pos) {
+			return 0;
+		}
+
+		pos += item->arg;
+		break;
+	case 4:
+	case 5: {
+		uint64_t count = (item->major == 5) ? 2 * item->arg : item->arg;
+
+		for (uint64_t i = 0; (item->info == 31) || (i < count); i++) {
+			if ((item->info == 31) && (pos < len) &&
+			    (data[pos] == 0xFF)) {
+				pos++;
+				break;
+			}
+
+			size_t nested_len = item_parse(&data[pos], len - pos,
+						       &nested);
+
+			if (nested_len == 0) {
+				return 0;
+			}
+
+			pos += nested_len;
+		}
+		break;
+	}
+	case 7:
+		if (item->info == 25) {
+			item->number = half_to_double(item->arg);
+		} else if (item->info == 26) {
+			uint32_t bits = item->arg;
+			float single;
+
+			memcpy(&single, &bits, sizeof(single));
+			item->number = single;
+		} else if (item->info == 27) {
+			memcpy(&item->number, &item->arg, sizeof(item->number));
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	item->len = pos;
+
+	return pos;
+}
+
+/* Find the item at a path of map keys and array indexes separated by dots,
+ * for instance "state.reported.gps.v.lat" or "gps.1.ts".
+ */
+static bool item_find(const uint8_t *data, size_t len, const char *path,
+		      struct item *item)
+{
+	char segment[32];
+	size_t segment_len = strcspn(path, ".");
+	size_t pos;
+	bool map;
+	uint64_t index = 0;
+
+	if (item_parse(data, len, item) == 0) {
+		return false;
+	}
+
+	if (*path == '\0') {
+		return true;
+	}
+
+	if ((item->major != 4 && item->major != 5) ||
+	    segment_len >= sizeof(segment)) {
+		return false;
+	}
+
+	memcpy(segment, path, segment_len);
+	segment[segment_len] = '\0';
+	path += segment_len + (path[segment_len] == '.');
+	map = item->major == 5;
+	len = item->len;
+	pos = data[0] & 0x1F;
+	pos = 1 + ((pos >= 24 && pos <= 27) ? (1 << (pos - 24)) : 0);
+
+	while ((pos < len) && (data[pos] != 0xFF)) {
+		struct item key = { 0 };
+		size_t key_len = 0;
+		bool match;
+
+		if (map) {
+			key_len = item_parse(&data[pos], len - pos, &key);
+			if (key_len == 0) {
+				return false;
+			}
+
+			match = (key.major == 3) && (key.arg == segment_len) &&
+				(memcmp(&data[pos + key_len - key.arg], segment,
+					segment_len) == 0);
+			pos += key_len;
+		} else {
+			match = index++ == strtoull(segment, NULL, 10);
+		}
+
+		if (match) {
+			return item_find(&data[pos], len - pos, path, item);
+		}
+
+		key_len = item_parse(&data[pos], len - pos, &key);
+		if (key_len == 0) {
+			return false;
+		}
+
+		pos += key_len;
+	}
+
+	return false;
+}
+
+/* Get the number at path, NAN if there is none. */
+static double number_get(const void *data, size_t len, const char *path)
+{
+	struct item item;
+
+	if (!item_find(data, len, path, &item) ||
+	    (item.major != 0 && item.major != 1 && item.major != 7)) {
+		return NAN;
+	}
+
+	return item.number;
+}
+
+static bool str_matches(const void *data, size_t len, const char *path,
+			const char *str)
+{
+	struct item item;
+
+	return item_find(data, len, path, &item) && (item.major == 3) &&
+	       (item.arg == strlen(str)) &&
+	       (memcmp(&item.start[item.len - item.arg], str, item.arg) == 0);
+}
+
+/* Check that the number at path is value, a fixed-point value with the
+ * given number of decimals.
+ */
+#define CHECK_NUMBER(data, len, path, value, decimals)                         \
+	CHECK(fabs(number_get(data, len, path) -                               \
+		   (value) / pow(10, decimals)) < 0.5 / pow(10, decimals))
+
+static int64_t unix_time(uint32_t ts)
+{
+	return HOST_UNIX_TIME_MS_AT_BOOT + cloud_data_ts_uptime(ts);
+}
+
+static void writer_check(const struct codec_writer *w, const char *hex)
+{
+	char out[2 * sizeof(buf) + 1];
+
+	for (size_t i = 0; i < w->len; i++) {
+		sprintf(&out[2 * i], "%02x", w->buf[i]);
+	}
+
+	out[2 * w->len] = '\0';
+
+	if (strcmp(out, hex) != 0) {
+		printf("encoded %s, expected %s\n", out, hex);
+		host_failures++;
+	}
+}
+
+static void number_check(double value, const char *hex)
+{
+	struct codec_writer w;
+
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_number(&w, NULL, value);
+	writer_check(&w, hex);
+}
+
+/* Examples of appendix A of RFC 7049 that apply to the writer. Floats are
+ * written in single precision if that holds the value, otherwise in double
+ * precision, never in half precision.
+ */
+static void test_writer_rfc7049(void)
+{
+	struct codec_writer w;
+
+	number_check(0, "00");
+	number_check(1, "01");
+	number_check(10, "0a");
+	number_check(23, "17");
+	number_check(24, "1818");
+	number_check(25, "1819");
+	number_check(100, "1864");
+	number_check(1000, "1903e8");
+	number_check(1000000, "1a000f4240");
+	number_check(1000000000000, "1b000000e8d4a51000");
+	number_check(-1, "20");
+	number_check(-10, "29");
+	number_check(-100, "3863");
+	number_check(-1000, "3903e7");
+	number_check(1.1, "fb3ff199999999999a");
+	number_check(3.4028234663852886e+38, "fa7f7fffff");
+	number_check(1.0e+300, "fb7e37e43c8800759c");
+	number_check(-4.1, "fbc010666666666666");
+	number_check(0.5, "fa3f000000");
+	/* JSON has no infinity or NaN, both backends write null. */
+	number_check(INFINITY, "f6");
+	number_check(NAN, "f6");
+
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_bool(&w, NULL, false);
+	codec_writer_bool(&w, NULL, true);
+	codec_writer_str(&w, NULL, NULL);
+	writer_check(&w, "f4f5f6");
+
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_str(&w, NULL, "");
+	codec_writer_str(&w, NULL, "a");
+	codec_writer_str(&w, NULL, "IETF");
+	codec_writer_str(&w, NULL, "\"\\");
+	codec_writer_str(&w, NULL, "\xc3\xbc");
+	writer_check(&w, "606161644945544662225c62c3bc");
+
+	/* [_ ] and {_ "a": 1, "b": [_ 2, 3]} */
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_arr_start(&w, NULL);
+	codec_writer_arr_end(&w);
+	CHECK_EQ(codec_writer_finish(&w), 0);
+	writer_check(&w, "9fff");
+
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_obj_start(&w, NULL);
+	codec_writer_number(&w, "a", 1);
+	codec_writer_arr_start(&w, "b");
+	codec_writer_number(&w, NULL, 2);
+	codec_writer_number(&w, NULL, 3);
+	codec_writer_arr_end(&w);
+	codec_writer_obj_end(&w);
+	CHECK_EQ(codec_writer_finish(&w), 0);
+	writer_check(&w, "bf61610161629f0203ffff");
+
+	/* Fixed precision values are rounded to the number of decimals and
+	 * written in single precision if that holds them.
+	 */
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_number_prec(&w, NULL, 180.04, 1);
+	codec_writer_number_prec(&w, NULL, 12.54, 1);
+	writer_check(&w, "18b4fa41480000");
+
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_number_prec(&w, NULL, 63.1234564, 6);
+	CHECK(fabs(number_get(buf, w.len, "") - 63.123456) < 1e-9);
+
+	/* An unterminated message and a full buffer are errors. */
+	codec_writer_init(&w, buf, sizeof(buf));
+	codec_writer_obj_start(&w, NULL);
+	CHECK_EQ(codec_writer_finish(&w), -EINVAL);
+
+	codec_writer_init(&w, buf, 3);
+	codec_writer_str(&w, NULL, "IETF");
+	CHECK_EQ(codec_writer_finish(&w), -ENOMEM);
+}
+
+static bool cfg_equal(const struct cloud_data_cfg *a,
+		      const struct cloud_data_cfg *b)
+{
+	return (a->act == b->act) && (a->gpst == b->gpst) &&
+	       (a->actw == b->actw) && (a->pasw == b->pasw) &&
+	       (a->movt == b->movt) && (a->acct == b->acct);
+}
+
+static size_t hex_decode(const char *hex, uint8_t *out)
+{
+	size_t len = strlen(hex) / 2;
+
+	for (size_t i = 0; i < len; i++) {
+		sscanf(&hex[2 * i], "%2hhx", &out[i]);
+	}
+
+	return len;
+}
+
+/* Decode a hand encoded message into cfg. */
+static int decode(const char *hex, struct cloud_data_cfg *cfg)
+{
+	size_t len = hex_decode(hex, buf);
+
+	return cloud_codec_decode_response((char *)buf, len, cfg);
+}
+
+/* Decode {"cfg": {"gpst": <value>}}, value is given in hex. */
+static int gpst_decode(const char *value_hex, int *gpst)
+{
+	char hex[64];
+	struct cloud_data_cfg cfg = { .gpst = -12345 };
+	int err;
+
+	snprintf(hex, sizeof(hex), "a163636667a16467707374%s", value_hex);
+	err = decode(hex, &cfg);
+	*gpst = cfg.gpst;
+
+	return err;
+}
+
+#define GPST_CHECK(value_hex, expected)                                        \
+	do {                                                                   \
+		int gpst;                                                      \
+		CHECK_EQ(gpst_decode(value_hex, &gpst), 0);                    \
+		CHECK_EQ(gpst, expected);                                      \
+	} while (0)
+
+static void test_decode_numbers(void)
+{
+	GPST_CHECK("00", 0);
+	GPST_CHECK("1903e8", 1000);
+	GPST_CHECK("3903e7", -1000);
+	GPST_CHECK("1a7fffffff", INT_MAX);
+	GPST_CHECK("3a7fffffff", INT_MIN);
+	GPST_CHECK("f5", 1);
+
+	/* Integers out of the range of int are limited to it. */
+	GPST_CHECK("1a80000000", INT_MAX);
+	GPST_CHECK("1bffffffffffffffff", INT_MAX);
+	GPST_CHECK("3a80000000", INT_MIN);
+	GPST_CHECK("3bffffffffffffffff", INT_MIN);
+
+	/* Floats of all precisions are truncated and limited to int. */
+	GPST_CHECK("f93e00", 1);
+	GPST_CHECK("f9c400", -4);
+	GPST_CHECK("f97bff", 65504);
+	GPST_CHECK("f90001", 0);
+	GPST_CHECK("f97c00", INT_MAX);
+	GPST_CHECK("f9fc00", INT_MIN);
+	GPST_CHECK("fa47c35000", 100000);
+	GPST_CHECK("fa7f7fffff", INT_MAX);
+	GPST_CHECK("faff800000", INT_MIN);
+	GPST_CHECK("fb3ff199999999999a", 1);
+	GPST_CHECK("fb7e37e43c8800759c", INT_MAX);
+	GPST_CHECK("fbc010666666666666", -4);
+	GPST_CHECK("fbfe37e43c8800759c", INT_MIN);
+
+	/* NaN, null and values of other types are not applied. */
+	GPST_CHECK("f97e00", -12345);
+	GPST_CHECK("fb7ff8000000000000", -12345);
+	GPST_CHECK("f6", -12345);
+	GPST_CHECK("6449455446", -12345);
+	GPST_CHECK("820102", -12345);
+}
+
+static void test_decode_messages(void)
+{
+	struct cloud_data_cfg cfg = { 0 };
+	const struct cloud_data_cfg unchanged = {
+		.gpst = 1, .actw = 2, .pasw = 3, .movt = 4, .acct = 5,
+	};
+
+	/* {_ "state": {_ "cfg": {_ "act": true, "mvt": 60, "x": [_ 1, {}],
+	 * "acct": 7}}}
+	 */
+	CHECK_EQ(decode("bf657374617465bf63636667bf63616374f5636d7674183c"
+			"61789f01a0ff6461636374""07ffffff", &cfg), 0);
+	CHECK_EQ(cfg.act, true);
+	CHECK_EQ(cfg.movt, 60);
+	CHECK_EQ(cfg.acct, 7);
+
+	/* Keys that are not text strings are skipped. */
+	cfg = unchanged;
+	CHECK_EQ(decode("a163636667a20118c8416705", &cfg), 0);
+	CHECK(cfg_equal(&cfg, &unchanged));
+
+	/* A message without a configuration leaves it unchanged. */
+	cfg = unchanged;
+	CHECK_EQ(decode("a1657374617465a0", &cfg), 0);
+	CHECK(cfg_equal(&cfg, &unchanged));
+
+	/* Truncated messages are rejected, and no value of them is applied.
+	 * The first one is the message above without its break codes.
+	 */
+	cfg = unchanged;
+	CHECK_EQ(decode("bf657374617465bf63636667bf63616374f5636d7674183c",
+			&cfg), -EBADMSG);
+	CHECK_EQ(decode("bf657374617465bf", &cfg), -EBADMSG);
+	CHECK_EQ(decode("bf63636667bf6461636374", &cfg), -EBADMSG);
+	CHECK_EQ(decode("a163636667a26461636374""07", &cfg), -EBADMSG);
+	CHECK_EQ(decode("a163636667a1646770737419", &cfg), -EBADMSG);
+	CHECK_EQ(decode("a163636667a1646770", &cfg), -EBADMSG);
+	CHECK(cfg_equal(&cfg, &unchanged));
+
+	/* Nesting beyond what the decoder skips is rejected. */
+	CHECK_EQ(decode("a163636667a161789f9f9f9f9f9f9f9f9f9f9f9f"
+			"ffffffffffffffffffffffff", &cfg), -EBADMSG);
+}
+
+static void test_cfg_round_trip(void)
+{
+	struct cloud_data_cfg cfg = {
+		.act = true,
+		.gpst = 60,
+		.actw = 120,
+		.pasw = 300,
+		.movt = 3600,
+		.acct = 10,
+	};
+	struct cloud_data_cfg decoded = { 0 };
+	struct cloud_codec_data output = {
+		.buf = (char *)buf, .size = sizeof(buf),
+	};
+	uint8_t message[256];
+	struct codec_writer w;
+	struct item item;
+
+	CHECK_EQ(cloud_codec_encode_cfg_data(&output, &cfg), 0);
+	CHECK_EQ(number_get(buf, output.len, "state.reported.cfg.gpst"), 60);
+	CHECK_EQ(number_get(buf, output.len, "state.reported.cfg.mvt"), 3600);
+
+	/* The cloud sends the reported configuration back as desired. */
+	CHECK(item_find(buf, output.len, "state.reported.cfg", &item));
+	codec_writer_init(&w, message, sizeof(message));
+	codec_writer_obj_start(&w, NULL);
+	codec_writer_obj_start(&w, "state");
+	codec_writer_encoded(&w, "cfg", item.start, item.len);
+	codec_writer_obj_end(&w);
+	codec_writer_obj_end(&w);
+	CHECK_EQ(codec_writer_finish(&w), 0);
+
+	CHECK_EQ(cloud_codec_decode_response((char *)message, w.len,
+					     &decoded), 0);
+	CHECK(cfg_equal(&decoded, &cfg));
+}
+
+static struct cloud_data_gps gps = {
+	.gps_ts = 98000,
+	.longi = -179123456,
+	.lat = 63123456,
+	.alt = -1234,
+	.acc = 55,
+	.spd = 12,
+	.hdg = 3599,
+};
+
+static struct cloud_data_sensors sensors = {
+	.env_ts = 98500, .temp = -123, .hum = 456,
+};
+
+static struct cloud_data_accelerometer accel = {
+	.ts = 99000, .values = { -981, 12, 5 },
+};
+
+static struct cloud_data_battery bat = { .bat_ts = 99500, .bat = 3800 };
+
+static struct cloud_data_ui ui = { .btn_ts = 99900, .btn = 2 };
+
+static void gps_check(const void *data, size_t len, const char *path,
+		      const struct cloud_data_gps *entry)
+{
+	char field[64];
+
+#define GPS_CHECK(_key, _member, _decimals)                                    \
+	snprintf(field, sizeof(field), "%s.v." _key, path);                    \
+	CHECK_NUMBER(data, len, field, entry->_member, _decimals)
+
+	GPS_CHECK("lng", longi, CLOUD_DATA_COORD_DECIMALS);
+	GPS_CHECK("lat", lat, CLOUD_DATA_COORD_DECIMALS);
+	GPS_CHECK("alt", alt, CLOUD_DATA_GPS_DECIMALS);
+	GPS_CHECK("acc", acc, CLOUD_DATA_GPS_DECIMALS);
+	GPS_CHECK("spd", spd, CLOUD_DATA_GPS_DECIMALS);
+	GPS_CHECK("hdg", hdg, CLOUD_DATA_GPS_DECIMALS);
+#undef GPS_CHECK
+
+	snprintf(field, sizeof(field), "%s.ts", path);
+	CHECK_EQ(number_get(data, len, field), unix_time(entry->gps_ts));
+}
+
+static void test_data_round_trip(void)
+{
+	struct cloud_codec_data output = {
+		.buf = (char *)buf, .size = sizeof(buf),
+	};
+	struct cloud_codec_report report;
+	struct cloud_data_modem modem = {
+		.mod_ts = 99200,
+		.area = 30401,
+		.cell = 52736,
+		.rsrp = 70,
+		.ip = cloud_codec_str_intern("10.0.0.1"),
+		.mccmnc = cloud_codec_str_intern("24201"),
+	};
+	struct cloud_data_modem_static modem_static = {
+		.ts = 90000,
+		.bnd = 20,
+		.nw_lte_m = true,
+		.nw_gps = true,
+		.appv = "1.0.0",
+		.brdv = "thingy91_nrf9160ns",
+		.fw = "mfw_nrf9160_1.2.2",
+		.iccid = "8931080019073497795F",
+	};
+	const void *data = buf;
+	size_t len;
+
+	cloud_codec_session_reset();
+
+	CHECK_EQ(cloud_codec_encode_data(&output, &report, &gps,
+					 &sensors, &modem,
+					 &modem_static, NULL, &accel,
+					 &bat), 0);
+	len = output.len;
+
+	gps_check(data, len, "state.reported.gps", &gps);
+
+	CHECK_NUMBER(data, len, "state.reported.env.v.temp", sensors.temp,
+		     CLOUD_DATA_ENV_DECIMALS);
+	CHECK_NUMBER(data, len, "state.reported.env.v.hum", sensors.hum,
+		     CLOUD_DATA_ENV_DECIMALS);
+	CHECK_EQ(number_get(data, len, "state.reported.env.ts"),
+		 unix_time(sensors.env_ts));
+
+	CHECK_NUMBER(data, len, "state.reported.acc.v.x", accel.values[0],
+		     CLOUD_DATA_ACCEL_DECIMALS);
+	CHECK_NUMBER(data, len, "state.reported.acc.v.y", accel.values[1],
+		     CLOUD_DATA_ACCEL_DECIMALS);
+	CHECK_NUMBER(data, len, "state.reported.acc.v.z", accel.values[2],
+		     CLOUD_DATA_ACCEL_DECIMALS);
+	CHECK_EQ(number_get(data, len, "state.reported.acc.ts"),
+		 unix_time(accel.ts));
+
+	CHECK_EQ(number_get(data, len, "state.reported.bat.v"), bat.bat);
+	CHECK_EQ(number_get(data, len, "state.reported.bat.ts"),
+		 unix_time(bat.bat_ts));
+
+	CHECK_EQ(number_get(data, len, "state.reported.roam.v.rsrp"), 70);
+	CHECK_EQ(number_get(data, len, "state.reported.roam.v.area"), 30401);
+	CHECK_EQ(number_get(data, len, "state.reported.roam.v.cell"), 52736);
+	CHECK_EQ(number_get(data, len, "state.reported.roam.v.mccmnc"), 24201);
+	CHECK(str_matches(data, len, "state.reported.roam.v.ip", "10.0.0.1"));
+	CHECK_EQ(number_get(data, len, "state.reported.roam.ts"),
+		 unix_time(modem.mod_ts));
+
+	CHECK_EQ(number_get(data, len, "state.reported.dev.v.band"), 20);
+	CHECK(str_matches(data, len, "state.reported.dev.v.nw", "LTE-M GPS"));
+	CHECK(str_matches(data, len, "state.reported.dev.v.iccid",
+			  modem_static.iccid));
+	CHECK(str_matches(data, len, "state.reported.dev.v.modV",
+			  modem_static.fw));
+	CHECK(str_matches(data, len, "state.reported.dev.v.brdV",
+			  modem_static.brdv));
+	CHECK(str_matches(data, len, "state.reported.dev.v.appV",
+			  modem_static.appv));
+	CHECK_EQ(number_get(data, len, "state.reported.dev.ts"),
+		 unix_time(modem_static.ts));
+
+	CHECK_EQ(cloud_codec_encode_ui_data(&output, &ui), 0);
+	CHECK_EQ(number_get(buf, output.len, "btn.v"), ui.btn);
+	CHECK_EQ(number_get(buf, output.len, "btn.ts"), unix_time(ui.btn_ts));
+}
+
+static void test_batch_round_trip(void)
+{
+	struct cloud_codec_data output = {
+		.buf = (char *)buf, .size = sizeof(buf),
+	};
+	struct cloud_data_gps entries[RING_SIZE];
+	char path[16];
+
+	data_pool_init(&data_pool);
+	data_pool_ring_add(&gps_ring);
+	data_pool_ring_add(&sensor_ring);
+	data_pool_ring_add(&modem_ring);
+	data_pool_ring_add(&ui_ring);
+	data_pool_ring_add(&accel_ring);
+	data_pool_ring_add(&bat_ring);
+
+	for (int i = 0; i < RING_SIZE; i++) {
+		entries[i] = gps;
+		entries[i].gps_ts += 10 * i;
+		entries[i].longi += 1000 * i;
+		entries[i].lat -= 1000 * i;
+		data_ring_put(&gps_ring, &entries[i]);
+	}
+
+	data_ring_put(&sensor_ring, &sensors);
+	data_ring_put(&accel_ring, &accel);
+	data_ring_put(&bat_ring, &bat);
+	data_ring_put(&ui_ring, &ui);
+
+	CHECK_EQ(cloud_codec_encode_batch(&output, &gps_ring, &sensor_ring,
+					  &modem_ring, &ui_ring, &accel_ring,
+					  &bat_ring), 0);
+	CHECK_EQ(output.entries, RING_SIZE + 4);
+
+	for (int i = 0; i < RING_SIZE; i++) {
+		snprintf(path, sizeof(path), "gps.%d", i);
+		gps_check(buf, output.len, path, &entries[i]);
+	}
+
+	CHECK_NUMBER(buf, output.len, "env.0.v.temp", sensors.temp,
+		     CLOUD_DATA_ENV_DECIMALS);
+	CHECK_NUMBER(buf, output.len, "acc.0.v.x", accel.values[0],
+		     CLOUD_DATA_ACCEL_DECIMALS);
+	CHECK_EQ(number_get(buf, output.len, "bat.0.v"), bat.bat);
+	CHECK_EQ(number_get(buf, output.len, "btn.0.v"), ui.btn);
+	CHECK_EQ(number_get(buf, output.len, "btn.0.ts"),
+		 unix_time(ui.btn_ts));
+
+	/* Encoded entries are dropped from their rings. */
+	CHECK_EQ(data_ring_count(&gps_ring), 0);
+	CHECK_EQ(cloud_codec_encode_batch(&output, &gps_ring, &sensor_ring,
+					  &modem_ring, &ui_ring, &accel_ring,
+					  &bat_ring), -ENODATA);
+}
+
+int main(void)
+{
+	test_writer_rfc7049();
+	test_decode_numbers();
+	test_decode_messages();
+	test_cfg_round_trip();
+	test_data_round_trip();
+	test_batch_round_trip();
+
+	return host_result("test_cloud_codec_cbor");
+}
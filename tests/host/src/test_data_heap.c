@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Test of the data heap, on a ring that shares its pool with a ring of a
+ * higher priority.
+ */
+
+#include <stdlib.h>
+#include <data_heap.h>
+#include "host.h"
+
+#define HEAP_SIZE 8
+#define POOL_SIZE 12
+#define PUT_COUNT 200
+
+struct test_entry {
+	uint32_t time;
+	int32_t key;
+};
+
+static int32_t key_get(const void *entry)
+{
+	return ((const struct test_entry *)entry)->key;
+}
+
+static int64_t time_get(const void *entry)
+{
+	return ((const struct test_entry *)entry)->time;
+}
+
+DATA_POOL_DEFINE(pool, struct test_entry, POOL_SIZE);
+DATA_RING_DEFINE(heap_ring, struct test_entry, HEAP_SIZE, pool, 0);
+DATA_RING_DEFINE(other_ring, struct test_entry, POOL_SIZE, pool, 1);
+DATA_HEAP_DEFINE(heap, heap_ring, key_get, time_get);
+
+/* Keys of all entries that were added, the highest are expected in the
+ * heap.
+ */
+static int32_t keys[PUT_COUNT + 1];
+static size_t key_count;
+static uint32_t time_now;
+
+static void reset(void)
+{
+	data_pool_init(&pool);
+	data_pool_ring_add(&heap_ring);
+	data_pool_ring_add(&other_ring);
+	data_heap_invalidate(&heap);
+	key_count = 0;
+}
+
+static bool put(int32_t key)
+{
+	struct test_entry entry = { .time = ++time_now, .key = key };
+
+	keys[key_count++] = key;
+
+	return data_heap_put(&heap, &entry);
+}
+
+static int key_compare(const void *a, const void *b)
+{
+	int32_t key_a = *(const int32_t *)a;
+	int32_t key_b = *(const int32_t *)b;
+
+	return (key_a < key_b) - (key_a > key_b);
+}
+
+static int32_t key_at(size_t index)
+{
+	return key_get(data_ring_get(&heap_ring, index));
+}
+
+/* The ring is ordered as a min-heap and the newest entry has the highest
+ * time.
+ */
+static void heap_check(void)
+{
+	size_t count = data_ring_count(&heap_ring);
+	struct test_entry *newest = data_heap_newest(&heap);
+
+	for (size_t i = 1; i < count; i++) {
+		CHECK(key_at((i - 1) / 2) <= key_at(i));
+	}
+
+	if (count == 0) {
+		CHECK(newest == NULL);
+		return;
+	}
+
+	CHECK(newest != NULL);
+	for (size_t i = 0; (newest != NULL) && (i < count); i++) {
+		struct test_entry *entry = data_ring_get(&heap_ring, i);
+
+		CHECK(entry->time <= newest->time);
+	}
+}
+
+/* The ring holds the entries with the highest keys that were added. */
+static void keys_check(void)
+{
+	size_t count = data_ring_count(&heap_ring);
+	int32_t ring_keys[HEAP_SIZE];
+
+	CHECK_EQ(count, MIN(key_count, HEAP_SIZE));
+
+	for (size_t i = 0; i < count; i++) {
+		ring_keys[i] = key_at(i);
+	}
+
+	qsort(ring_keys, count, sizeof(ring_keys[0]), key_compare);
+	qsort(keys, key_count, sizeof(keys[0]), key_compare);
+
+	for (size_t i = 0; i < count; i++) {
+		CHECK_EQ(ring_keys[i], keys[i]);
+	}
+}
+
+static void test_highest_kept(void)
+{
+	uint32_t dropped = 0;
+
+	reset();
+	heap_ring.dropped = 0;
+	heap_check();
+
+	srand(1);
+
+	for (size_t i = 0; i < PUT_COUNT; i++) {
+		int32_t key = rand() % 1000 - 500;
+		struct test_entry *weakest = data_ring_get(&heap_ring, 0);
+		bool kept = !data_ring_is_full(&heap_ring) ||
+			    (key > weakest->key);
+
+		if (data_ring_is_full(&heap_ring)) {
+			dropped++;
+		}
+
+		CHECK_EQ(put(key), kept);
+		CHECK_EQ(data_ring_dropped(&heap_ring), dropped);
+		heap_check();
+
+		if (kept) {
+			struct test_entry *newest = data_heap_newest(&heap);
+
+			CHECK(newest != NULL);
+			CHECK_EQ(newest ? newest->time : 0, time_now);
+		}
+	}
+
+	keys_check();
+
+	/* A key equal to the lowest does not replace it. */
+	CHECK(!put(key_at(0)));
+	CHECK_EQ(data_ring_dropped(&heap_ring), dropped + 1);
+}
+
+/* Entries removed by the owner of the ring or evicted by the pool. */
+static void test_restore(void)
+{
+	struct test_entry other = { 0 };
+	struct test_entry *newest;
+
+	reset();
+
+	for (int32_t key = 1; key <= HEAP_SIZE; key++) {
+		put(key);
+	}
+
+	/* Publishing the newest entry. */
+	data_ring_remove(&heap_ring, heap.newest);
+	data_heap_invalidate(&heap);
+	heap_check();
+	newest = data_heap_newest(&heap);
+	CHECK_EQ(newest ? newest->key : 0, HEAP_SIZE - 1);
+
+	/* Publishing the oldest entries in ring order. */
+	data_ring_pop(&heap_ring, 2);
+	data_heap_invalidate(&heap);
+	heap_check();
+	CHECK_EQ(data_ring_count(&heap_ring), HEAP_SIZE - 3);
+
+	/* The other ring takes the free slots and then evicts entries of the
+	 * heap, which are rebuilt without invalidating it.
+	 */
+	for (size_t i = 0; i < POOL_SIZE - 2; i++) {
+		data_ring_put(&other_ring, &other);
+	}
+
+	CHECK_EQ(data_ring_count(&heap_ring), 2);
+	heap_check();
+
+	/* The pool is exhausted, an entry of the heap makes room. */
+	CHECK(put(100));
+	CHECK_EQ(data_ring_count(&heap_ring), 2);
+	heap_check();
+	newest = data_heap_newest(&heap);
+	CHECK_EQ(newest ? newest->key : 0, 100);
+
+	data_ring_pop(&other_ring, POOL_SIZE);
+	data_ring_pop(&heap_ring, HEAP_SIZE);
+	data_heap_invalidate(&heap);
+	heap_check();
+	CHECK(data_heap_newest(&heap) == NULL);
+}
+
+int main(void)
+{
+	test_highest_kept();
+	test_restore();
+
+	return host_result("test_data_heap");
+}
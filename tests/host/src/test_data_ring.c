@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+/* Test of the data rings and the pool that they share. */
+
+#include <errno.h>
+#include <data_ring.h>
+#include "host.h"
+
+#define POOL_SIZE 6
+#define RING_SIZE 4
+
+struct big_entry {
+	uint32_t value[2];
+};
+
+DATA_POOL_DEFINE(pool, uint32_t, POOL_SIZE);
+DATA_RING_DEFINE(low_ring, uint32_t, RING_SIZE, pool, 0);
+DATA_RING_DEFINE(mid_ring, uint32_t, RING_SIZE, pool, 1);
+DATA_RING_DEFINE(peer_ring, uint32_t, RING_SIZE, pool, 1);
+DATA_RING_DEFINE(high_ring, uint32_t, RING_SIZE, pool, 2);
+DATA_RING_DEFINE(big_ring, struct big_entry, RING_SIZE, pool, 0);
+
+static void pool_reset(void)
+{
+	data_pool_init(&pool);
+	CHECK_EQ(data_pool_ring_add(&low_ring), 0);
+	CHECK_EQ(data_pool_ring_add(&mid_ring), 0);
+	CHECK_EQ(data_pool_ring_add(&peer_ring), 0);
+	CHECK_EQ(data_pool_ring_add(&high_ring), 0);
+	low_ring.dropped = 0;
+	mid_ring.dropped = 0;
+	peer_ring.dropped = 0;
+	high_ring.dropped = 0;
+}
+
+static void put(struct data_ring *ring, uint32_t value, bool added)
+{
+	CHECK_EQ(data_ring_put(ring, &value), added);
+}
+
+/* Check the values of a ring from the oldest to the newest entry. */
+static void ring_check(const struct data_ring *ring, const uint32_t *values,
+		       size_t count)
+{
+	CHECK_EQ(data_ring_count(ring), count);
+
+	for (size_t i = 0; i < count; i++) {
+		uint32_t *entry = data_ring_get(ring, i);
+
+		CHECK(entry != NULL);
+		if (entry != NULL) {
+			CHECK_EQ(*entry, values[i]);
+		}
+	}
+
+	CHECK(data_ring_get(ring, count) == NULL);
+	if (count > 0) {
+		CHECK(data_ring_newest(ring) == data_ring_get(ring, count - 1));
+	} else {
+		CHECK(data_ring_newest(ring) == NULL);
+	}
+}
+
+/* A full ring replaces its oldest entry, and keeps its order while the tail
+ * wraps around.
+ */
+static void test_wrap_around(void)
+{
+	pool_reset();
+
+	for (uint32_t i = 0; i < 10; i++) {
+		put(&low_ring, i, true);
+	}
+
+	ring_check(&low_ring, (uint32_t[]){ 6, 7, 8, 9 }, 4);
+	CHECK(data_ring_is_full(&low_ring));
+	CHECK_EQ(data_ring_dropped(&low_ring), 6);
+	CHECK_EQ(data_pool_free_count(&pool), POOL_SIZE - RING_SIZE);
+
+	data_ring_pop(&low_ring, 3);
+	ring_check(&low_ring, (uint32_t[]){ 9 }, 1);
+	CHECK_EQ(data_pool_free_count(&pool), POOL_SIZE - 1);
+
+	put(&low_ring, 10, true);
+	put(&low_ring, 11, true);
+	ring_check(&low_ring, (uint32_t[]){ 9, 10, 11 }, 3);
+
+	data_ring_newest_drop(&low_ring);
+	ring_check(&low_ring, (uint32_t[]){ 9, 10 }, 2);
+
+	put(&low_ring, 12, true);
+	put(&low_ring, 13, true);
+	put(&low_ring, 14, true);
+	ring_check(&low_ring, (uint32_t[]){ 10, 12, 13, 14 }, 4);
+
+	data_ring_swap(&low_ring, 0, 3);
+	data_ring_swap(&low_ring, 1, RING_SIZE);
+	ring_check(&low_ring, (uint32_t[]){ 14, 12, 13, 10 }, 4);
+
+	data_ring_remove(&low_ring, 0);
+	data_ring_remove(&low_ring, RING_SIZE);
+	ring_check(&low_ring, (uint32_t[]){ 10, 12, 13 }, 3);
+
+	data_ring_pop(&low_ring, RING_SIZE);
+	ring_check(&low_ring, NULL, 0);
+	data_ring_newest_drop(&low_ring);
+	ring_check(&low_ring, NULL, 0);
+	CHECK_EQ(data_pool_free_count(&pool), POOL_SIZE);
+	CHECK_EQ(data_ring_dropped(&low_ring), 7);
+}
+
+/* An exhausted pool evicts the oldest entry of the ring with the lowest
+ * priority, the ring itself among rings of equal priority.
+ */
+static void test_eviction_order(void)
+{
+	pool_reset();
+
+	put(&low_ring, 1, true);
+	put(&low_ring, 2, true);
+	put(&mid_ring, 11, true);
+	put(&peer_ring, 31, true);
+	put(&high_ring, 21, true);
+	put(&high_ring, 22, true);
+	CHECK_EQ(data_pool_free_count(&pool), 0);
+
+	/* Lowest priority first, oldest entry first. */
+	put(&high_ring, 23, true);
+	ring_check(&low_ring, (uint32_t[]){ 2 }, 1);
+	CHECK_EQ(data_ring_dropped(&low_ring), 1);
+
+	put(&mid_ring, 12, true);
+	ring_check(&low_ring, NULL, 0);
+	CHECK_EQ(data_ring_dropped(&low_ring), 2);
+
+	/* A ring evicts its own oldest entry before one of another ring of
+	 * the same priority.
+	 */
+	put(&mid_ring, 13, true);
+	ring_check(&mid_ring, (uint32_t[]){ 12, 13 }, 2);
+	ring_check(&peer_ring, (uint32_t[]){ 31 }, 1);
+	CHECK_EQ(data_ring_dropped(&mid_ring), 1);
+
+	put(&peer_ring, 32, true);
+	ring_check(&peer_ring, (uint32_t[]){ 32 }, 1);
+	ring_check(&mid_ring, (uint32_t[]){ 12, 13 }, 2);
+	CHECK_EQ(data_ring_dropped(&peer_ring), 1);
+
+	put(&high_ring, 24, true);
+	ring_check(&high_ring, (uint32_t[]){ 21, 22, 23, 24 }, 4);
+	CHECK_EQ(data_ring_count(&mid_ring) + data_ring_count(&peer_ring), 2);
+
+	/* The quota of a ring applies before the pool evicts. */
+	put(&high_ring, 25, true);
+	ring_check(&high_ring, (uint32_t[]){ 22, 23, 24, 25 }, 4);
+	CHECK_EQ(data_ring_dropped(&high_ring), 1);
+	CHECK_EQ(data_pool_free_count(&pool), 0);
+}
+
+/* A new entry is dropped if only rings with a higher priority hold entries,
+ * and slots return to the pool when entries are published.
+ */
+static void test_pool_exhaustion(void)
+{
+	pool_reset();
+
+	for (uint32_t i = 0; i < RING_SIZE; i++) {
+		put(&high_ring, 20 + i, true);
+	}
+	put(&mid_ring, 10, true);
+	put(&mid_ring, 11, true);
+	CHECK_EQ(data_pool_free_count(&pool), 0);
+
+	put(&low_ring, 1, false);
+	ring_check(&low_ring, NULL, 0);
+	CHECK_EQ(data_ring_dropped(&low_ring), 1);
+
+	put(&mid_ring, 12, true);
+	ring_check(&mid_ring, (uint32_t[]){ 11, 12 }, 2);
+	ring_check(&high_ring, (uint32_t[]){ 20, 21, 22, 23 }, 4);
+
+	data_ring_pop(&mid_ring, 1);
+	CHECK_EQ(data_pool_free_count(&pool), 1);
+	put(&low_ring, 2, true);
+	CHECK_EQ(data_pool_free_count(&pool), 0);
+	ring_check(&low_ring, (uint32_t[]){ 2 }, 1);
+
+	data_ring_pop(&high_ring, RING_SIZE);
+	data_ring_pop(&mid_ring, RING_SIZE);
+	data_ring_pop(&low_ring, RING_SIZE);
+	CHECK_EQ(data_pool_free_count(&pool), POOL_SIZE);
+
+	/* Every slot is handed out once. */
+	for (uint32_t i = 0; i < RING_SIZE; i++) {
+		put(&low_ring, i, true);
+	}
+	put(&mid_ring, 10, true);
+	put(&mid_ring, 11, true);
+
+	for (size_t i = 0; i < data_ring_count(&low_ring); i++) {
+		uint32_t *entry = data_ring_get(&low_ring, i);
+
+		for (size_t j = 0; j < data_ring_count(&mid_ring); j++) {
+			CHECK(entry != data_ring_get(&mid_ring, j));
+		}
+	}
+
+	CHECK_EQ(data_pool_ring_add(&big_ring), -EINVAL);
+}
+
+static size_t released;
+
+static void entry_release(const void *entry)
+{
+	released++;
+}
+
+/* Every entry that leaves the ring or is not added is released. */
+static void test_release(void)
+{
+	pool_reset();
+	released = 0;
+	low_ring.release = entry_release;
+
+	for (uint32_t i = 0; i < RING_SIZE + 1; i++) {
+		put(&low_ring, i, true);
+	}
+	CHECK_EQ(released, 1);
+
+	data_ring_newest_drop(&low_ring);
+	data_ring_remove(&low_ring, 0);
+	data_ring_pop(&low_ring, 1);
+	CHECK_EQ(released, 4);
+
+	for (uint32_t i = 0; i < RING_SIZE; i++) {
+		put(&high_ring, 20 + i, true);
+	}
+	put(&mid_ring, 10, true);
+	put(&mid_ring, 11, true);
+	CHECK_EQ(data_ring_count(&low_ring), 0);
+	CHECK_EQ(released, 5);
+
+	put(&low_ring, 1, false);
+	CHECK_EQ(released, 6);
+	CHECK_EQ(data_ring_count(&low_ring), 0);
+
+	data_ring_pop(&high_ring, RING_SIZE);
+	put(&low_ring, 2, true);
+	data_ring_pop(&low_ring, RING_SIZE);
+	CHECK_EQ(released, 7);
+
+	low_ring.release = NULL;
+}
+
+int main(void)
+{
+	test_wrap_around();
+	test_eviction_order();
+	test_pool_exhaustion();
+	test_release();
+
+	return host_result("test_data_ring");
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2021, Nordic Semiconductor ASA | nordicsemi.no
+ *
+ * SPDX-License-Identifier: LicenseRef-BSD-5-Clause-Nordic
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#include <zephyr.h>
+#include <date_time.h>
+#include <sys/crc.h>
+#include "host.h"
+
+int64_t host_uptime_ms = 100000;
+bool host_time_valid = true;
+int host_failures;
+
+uint64_t host_ns_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int64_t k_uptime_get(void)
+{
+	return host_uptime_ms;
+}
+
+/* The cycle counter of the host runs at 1 GHz. */
+uint32_t k_cycle_get_32(void)
+{
+	return (uint32_t)host_ns_get();
+}
+
+uint64_t k_cyc_to_ns_floor64(uint64_t cycles)
+{
+	return cycles;
+}
+
+void printk(const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
+int date_time_uptime_to_unix_time_ms(int64_t *uptime)
+{
+	if (!host_time_valid) {
+		return -ENODATA;
+	}
+
+	*uptime += HOST_UNIX_TIME_MS_AT_BOOT;
+
+	return 0;
+}
+
+int date_time_now(int64_t *unix_time_ms)
+{
+	if (!host_time_valid) {
+		return -ENODATA;
+	}
+
+	*unix_time_ms = HOST_UNIX_TIME_MS_AT_BOOT + host_uptime_ms;
+
+	return 0;
+}
+
+uint32_t crc32_ieee_update(uint32_t crc, const uint8_t *data, size_t len)
+{
+	crc = ~crc;
+
+	while (len--) {
+		crc ^= *data++;
+
+		for (int i = 0; i < 8; i++) {
+			crc = (crc >> 1) ^ (0xEDB88320U & -(crc & 1));
+		}
+	}
+
+	return ~crc;
+}